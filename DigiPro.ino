@@ -78,7 +78,7 @@ void readVoltage() {
  *****************************************/
 void setup() {
 
-    /* CONFIGURE WATCHDOG FOR 1HZ INTERRUPT */
+    /* CONFIGURE WATCHDOG FOR 1HZ INTERRUPT (PERIOD LENGTHEN BY WDT_WAKE) */
     Watchdog_setup();
 
     /* BATTERY VOLTAGE SENSOR */
@@ -113,24 +113,22 @@ void loop() {
     uint32_t t;
     static uint32_t sensor_to;
 
-    /* GO TO SLEEP FOR 1 SECOND IF NO REQUEST FROM MODULE */
-    if(digitalRead(LORA_DIO) == LOW) {
-
-        /* ENABLE INTERRUPT ON DIO0 TO WAKE-UP FROM SLEEP */
-        PCMSK2 = 0x08;    // PCINT19 pin-on-change interrupt for PD3
-        PCICR = 0x04;     // PCINT2 ENABLE
+    /* GO TO SLEEP UNTIL NEXT DEADLINE IF NO FRAME IN RX QUEUE */
+    wdt_flag = 0;
+    t = DigiNextEvent();
+    if(t > sensor_to + 1) t = sensor_to + 1;
+    cli();
+    wdt_wake = t;
+    if(!lora.rxPending()) {
     
-        /* POWER DOWN CPU, WAKE-UP WITH 1Hz WATCHDOG INTERRUPT OR INCOMING PACKET */
-        wdt_flag = 0;
+        /* POWER DOWN CPU, WAKE-UP WITH WATCHDOG INTERRUPT (1 TO 8 SEC) OR DIO0 INTERRUPT (INCOMING PACKET) */
         set_sleep_mode(SLEEP_MODE_PWR_DOWN);
         sleep_enable();
-        sleep_mode();		// Watchdog wake CPU or DIO0 rising level, set in SX1278.CPP
+        sei();
+        sleep_cpu();		// Watchdog wake CPU or DIO0 pin change, set in SX1278.CPP
         sleep_disable();
-
-        /* DISABLE DIO0 INTERRUPT */
-        PCICR = 0;
-        PCMSK2 = 0;
     }
+    sei();
 
 	/* CHECK SENSOR EACH MINUTE */
     if(wdt_clk > sensor_to) {
@@ -166,12 +164,16 @@ void loop() {
 			lora.setPower(13);		// 20mW beacon 
 			sleep_flag = 1;		
 			DigiSendBeacon(2);    	// send system beacon for sleep mode
-			lora.setPower(LORA_POWER);
+			DigiFlush();			// queued, send it before radio sleep
+			lora.setPower(Config[CFG_POWER]);
 		}        
         DigiSleep();          // Put lora radio module in sleep
         
-        /* WAIT 15 MINUTES */
+        /* WAIT 15 MINUTES, WATCHDOG WAKE EACH 8 SEC */
         t = wdt_clk + (60 * 15);
+        cli();
+        wdt_wake = t;
+        sei();
         while(wdt_clk < t) {
             wdt_flag = 0;
             set_sleep_mode(SLEEP_MODE_PWR_DOWN);
@@ -179,6 +181,12 @@ void loop() {
             sleep_mode();
             sleep_disable();
         }
+
+        /* WAKE RADIO, RESET BOARD IF MODULE IS LOST */
+        if(DigiWake() == 0) {
+            wdt_flag = 31;
+            while(1);
+        }
                 
     } else sleep_flag = 0; 
 	#endif
@@ -0,0 +1,223 @@
+
+#include "project.h"
+
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+
+/* RUNTIME PARAMETER, LOADED FROM EEPROM AT BOOT */
+uint16_t Config[CFG_COUNT];
+
+/* Parameter name (2 letters in message), range and default value */
+struct TConfigParam {
+    char name[3];
+    uint16_t min;
+    uint16_t max;
+    uint16_t def;
+} TConfigParam;
+
+const struct TConfigParam ConfigParam[CFG_COUNT] PROGMEM = {
+    { "B1", 300, 65535, B1_INTERVAL },
+    { "B2", 300, 65535, B2_INTERVAL },
+    { "B3", 300, 65535, B3_INTERVAL },
+    { "TL", 300, 65535, TELEM_INTERVAL },
+    { "WN", 1,   7,     WIDEN_MAX },
+    { "PW", 2,   20,    LORA_POWER },
+    #if CHANNEL_ADAPTIVE==1
+    { "PS", 1,   255,   CHANNEL_PERSIST_MAX },     // Quiet channel bound
+    { "SL", 10,  1000,  CHANNEL_SLOTTIME_MIN },
+    #else
+    { "PS", 1,   255,   CHANNEL_PERSIST },
+    { "SL", 10,  1000,  CHANNEL_SLOTTIME },
+    #endif
+    { "DD", 20,  90,    DUP_DELAY },
+    { "LF", 5,   100,   CHANNEL_LOAD_FULL },
+};
+
+/* EEPROM record, ignored if CRC is bad or parameter count change */
+struct TConfigRecord {
+    uint8_t count;
+    uint32_t seq;               // Last sequence accepted, reject replayed command
+    uint16_t value[CFG_COUNT];
+    uint16_t crc;
+} TConfigRecord;
+
+struct TConfigRecord EEMEM ConfigEeprom;
+uint32_t ConfigSeqNum;
+
+#ifdef CFG_KEY
+const char ConfigKey[17] PROGMEM = CFG_KEY;
+static_assert(sizeof(CFG_KEY) == 17, "CFG_KEY must be 16 caracters");
+#endif
+
+
+/******************************************************************************
+ * uint16_t ConfigCRC(struct TConfigRecord *r)
+ *
+ * CRC-16 of record, without CRC field.
+ *****************************************************************************/
+uint16_t ConfigCRC(struct TConfigRecord *r) {
+    uint16_t crc = 0xFFFF;
+    uint8_t i;
+
+    for(i=0; i<sizeof(struct TConfigRecord) - 2; i++) crc = _crc16_update(crc, ((uint8_t*)r)[i]);
+    return crc;
+}
+
+
+/******************************************************************************
+ * void ConfigDefault()
+ *
+ * Set all parameter to project.h value.
+ *****************************************************************************/
+void ConfigDefault() {
+    for(uint8_t i=0; i<CFG_COUNT; i++) Config[i] = pgm_read_word(&ConfigParam[i].def);
+}
+
+
+/******************************************************************************
+ * void ConfigLoad()
+ *
+ * Read parameter from EEPROM, default value if record is invalid.
+ *****************************************************************************/
+void ConfigLoad() {
+    struct TConfigRecord r;
+    uint8_t i;
+
+    ConfigDefault();
+    eeprom_read_block(&r, &ConfigEeprom, sizeof(r));
+    if(r.count != CFG_COUNT || r.crc != ConfigCRC(&r)) return;
+
+    ConfigSeqNum = r.seq;
+    for(i=0; i<CFG_COUNT; i++) ConfigSet(i, r.value[i]);
+}
+
+
+/******************************************************************************
+ * void ConfigSave()
+ *
+ * Write parameter and sequence in EEPROM, only changed bytes are written.
+ *****************************************************************************/
+void ConfigSave() {
+    struct TConfigRecord r;
+
+    r.count = CFG_COUNT;
+    r.seq = ConfigSeqNum;
+    memcpy(r.value, Config, sizeof(r.value));
+    r.crc = ConfigCRC(&r);
+    eeprom_update_block(&r, &ConfigEeprom, sizeof(r));
+}
+
+
+/******************************************************************************
+ * uint8_t ConfigFind(const char *name)
+ *
+ * Return parameter index from 2 letters name, CFG_COUNT if not found.
+ *****************************************************************************/
+uint8_t ConfigFind(const char *name) {
+    uint8_t i;
+
+    for(i=0; i<CFG_COUNT; i++) if(strncmp_P(name, ConfigParam[i].name, 2) == 0) break;
+    return i;
+}
+
+
+/******************************************************************************
+ * uint8_t ConfigSet(uint8_t id, uint16_t value)
+ *
+ * Set parameter, return 0 if value is out of range.
+ *****************************************************************************/
+uint8_t ConfigSet(uint8_t id, uint16_t value) {
+    if(id >= CFG_COUNT) return 0;
+    if(value < pgm_read_word(&ConfigParam[id].min) || value > pgm_read_word(&ConfigParam[id].max)) return 0;
+    Config[id] = value;
+    return 1;
+}
+
+
+/******************************************************************************
+ * uint8_t ConfigPrint(char *out, uint8_t id)
+ *
+ * Write "XX=value" to out, return length.
+ *****************************************************************************/
+uint8_t ConfigPrint(char *out, uint8_t id) {
+    char name[3];
+
+    strcpy_P(name, ConfigParam[id].name);
+    return sprintf_P(out, PSTR("%s=%u"), name, Config[id]);
+}
+
+
+/******************************************************************************
+ * uint32_t ConfigSeq()
+ *
+ * Last sequence accepted, next command must use a higher one.
+ *****************************************************************************/
+uint32_t ConfigSeq() {
+    return ConfigSeqNum;
+}
+
+
+/******************************************************************************
+ * XTEA block cipher (32 cycles), key is CFG_KEY read as 4 little endian
+ * words. ConfigMac() is CBC-MAC with length in first block, byte are
+ * packed little endian in the 2 words. MAC is first word.
+ *****************************************************************************/
+#ifdef CFG_KEY
+void Xtea(uint32_t *v) {
+    uint32_t v0 = v[0], v1 = v[1], sum = 0;
+    uint8_t i;
+
+    for(i=0; i<32; i++) {
+        v0 += (((v1 << 4) ^ (v1 >> 5)) + v1) ^ (sum + pgm_read_dword(&ConfigKey[4 * (sum & 3)]));
+        sum += 0x9E3779B9;
+        v1 += (((v0 << 4) ^ (v0 >> 5)) + v0) ^ (sum + pgm_read_dword(&ConfigKey[4 * ((sum >> 11) & 3)]));
+    }
+    v[0] = v0;
+    v[1] = v1;
+}
+
+uint32_t ConfigMac(const char *text, uint8_t len) {
+    uint8_t i, n = strlen(MYCALL) + 1;       // "MYCALL:" before text
+    uint32_t v[2] = { (uint32_t)n + len, 0 };
+    char c;
+
+    Xtea(v);
+    for(i=0; i<n+len; i++) {
+        c = (i < n-1) ? MYCALL[i] : (i == n-1) ? ':' : text[i-n];
+        v[(i >> 2) & 1] ^= (uint32_t)(uint8_t)c << (8 * (i & 3));
+        if((i & 7) == 7 || i == n+len-1) Xtea(v);
+    }
+    return v[0];
+}
+#endif
+
+
+/******************************************************************************
+ * uint8_t ConfigAuth(const char *text)
+ *
+ * Check command ending with "seq mac". Mac is 8 hex digit ConfigMac() of
+ * "MYCALL:" followed by text up to seq. Seq must be higher than last one
+ * accepted. Return 1 if command is authentic. Always 0 without CFG_KEY.
+ * Seq is 32 bits in EEPROM and never wrap (4294967295 refused). Only reset
+ * is a lost EEPROM record (CRC error, seq back to 0): change CFG_KEY then.
+ *****************************************************************************/
+uint8_t ConfigAuth(const char *text) {
+#ifdef CFG_KEY
+    const char *m, *s;
+    unsigned long seq;
+
+    /* MAC IS LAST FIELD, SEQUENCE BEFORE */
+    m = strrchr(text, ' ');
+    if(m == 0) return 0;
+    for(s=m-1; s>text && *s!=' '; s--);
+    if(s == text) return 0;
+    seq = strtoul(s+1, 0, 10);
+    if(seq <= ConfigSeqNum || seq >= 0xFFFFFFFFUL) return 0;     // Replay, or saturated/over 32 bits
+    if(ConfigMac(text, m - text) != strtoul(m+1, 0, 16)) return 0;
+
+    ConfigSeqNum = seq;
+    return 1;
+#else
+    return 0;
+#endif
+}
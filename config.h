@@ -0,0 +1,28 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+/* RUNTIME PARAMETER, DEFAULT FROM PROJECT.H, SAVED IN EEPROM */
+#define CFG_B1       0    // Beacon 1 interval (sec)
+#define CFG_B2       1    // Beacon 2 interval
+#define CFG_B3       2    // Status beacon interval
+#define CFG_TELEM    3    // Telemetry interval
+#define CFG_WIDEN    4    // WIDEn-N maximum
+#define CFG_POWER    5    // Radio power (dbm)
+#define CFG_PERSIST  6    // Persistance (0-255, quiet channel value when adaptive)
+#define CFG_SLOT     7    // Slottime (ms, quiet channel value when adaptive)
+#define CFG_DUP      8    // Duplicate delay (sec)
+#define CFG_LOADFULL 9    // Channel busy % giving full backoff (adaptive)
+#define CFG_COUNT    10
+
+extern uint16_t Config[CFG_COUNT];
+
+void ConfigLoad();
+void ConfigSave();
+void ConfigDefault();
+uint8_t ConfigFind(const char *name);
+uint8_t ConfigSet(uint8_t id, uint16_t value);
+uint8_t ConfigPrint(char *out, uint8_t id);
+uint8_t ConfigAuth(const char *text);
+uint32_t ConfigSeq();
+
+#endif
@@ -1,34 +1,258 @@
 
 #include "project.h"
 
+#include <avr/sleep.h>
+
 /* LORA MODULE, CONFIG OVERWRITED BY SETTING IN PROJECT.H */
 SX1278 lora(SX1278_BW_125_00_KHZ, SX1278_SF_12, SX1278_CR_4_5);
 
-/* TELEMETRY CONFIG */
-const char TelemSequence[] = { 1,1,1,4,1,1,1,3,1,1,1,2,1,1,1,0 }; 
-
-/* PAYLOAD BUFFER */
-static unsigned char pkt[255], index;
-bool pkt_oe_format;
+/* Path alias rules, checked in order on first unused path entry. Rule with 
+   RULE_PREEMPT may also match further down the path, unused entries before 
+   it are removed. 
+   n-N alias (RULE_NN): N decremented, when N stay over 0 our call is inserted 
+   before (RULE_INSERT), when N reach 0 alias is replaced by our call 
+   (RULE_SUBST) or marked used with our call inserted before (trace). 
+   Fixed alias: same as N reaching 0 */
+#define RULE_NN      0x01   // Alias followed by n digit and SSID N, both 1 to max
+#define RULE_INSERT  0x02   // Insert our call before alias
+#define RULE_SUBST   0x04   // Replace alias by our call when N reach 0
+#define RULE_PREEMPT 0x08   // May match after first unused entry
+#define RULE_MYCALL  0x10   // Alias is our call (MYCALL)
+#define RULE_CFGMAX  0x20   // Max from Config[CFG_WIDEN] (remote config WN)
+
+struct TAliasRule {
+    char alias[7];          // Alias without n digit
+    uint8_t max;            // Max n and N (n-N alias), else SSID of fixed alias
+    uint8_t flag;
+} TAliasRule;
+
+const struct TAliasRule AliasRule[] PROGMEM = {
+    { "WIDE",      0,         RULE_NN | RULE_INSERT | RULE_SUBST | RULE_CFGMAX },
+    #if TRACEN_MAX > 0
+    { "TRACE",     TRACEN_MAX, RULE_NN | RULE_INSERT },
+    #endif
+    { "",          0,         RULE_MYCALL | RULE_SUBST | RULE_PREEMPT },
+    #ifdef DIGI_ALIAS
+    { DIGI_ALIAS,  0,         RULE_SUBST | RULE_PREEMPT },
+    #endif
+};
+
+/* Action on matched path entry */
+#define ACT_DECR   0x01     // Write new N to alias
+#define ACT_MARK   0x02     // Mark alias used
+#define ACT_SUBST  0x04     // Replace alias by our call (used)
+#define ACT_INSERT 0x08     // Insert our call before alias (used)
+
+/* Frame buffer pool, each slot is owned by receiver (RX and digipeat rules),
+   by frame under construction (TX) or by transmit queue, no heap allocation */
+#define FRAME_FREE   0
+#define FRAME_RX     1
+#define FRAME_TX     2
+#define FRAME_QUEUED 3
+
+/* Transmit queue priority class, lower first */
+#define TXQ_DIGI   0
+#define TXQ_ACK    1
+#define TXQ_QUERY  2
+#define TXQ_BEACON 3
+#define TXQ_TELEM  4
+
+struct TFrame {
+    uint8_t owner;          // FRAME_FREE, FRAME_RX, FRAME_TX or FRAME_QUEUED
+    uint8_t len;            // Frame length
+    uint8_t prio;           // Transmit queue class (TXQ_xxx)
+    uint32_t deadline;      // wdt_clk after which queued frame is dropped
+    uint32_t hold;          // wdt_clk before which digipeat is held (viscous mode)
+    uint16_t fp;            // Fingerprint of digipeated frame
+    unsigned char buf[FRAME_SIZE];
+} TFrame;
+
+struct TFrame Frame[FRAME_POOL];
+
+/* FRAME IN RX SLOT AND FRAME UNDER CONSTRUCTION (TX SLOT) */
+static struct TFrame *RxFrame, *TxFrame;
+static unsigned char *pkt, index;
+
+/* NODE CALL IN AX25 FORMAT AND MESSAGE HEADER, SET AT INIT */
+unsigned char NodeCall[7];
+char MsgHeader[12];            // ":MYCALL   :"
+
+/* Frame descriptor, built in one pass by FrameParse() and used by all rules.
+   Offset are in frame buffer, path entry (hop) offset point on first byte of 
+   call, for both AX25 and ASCII format */
+#define VIEW_MAXHOP 8      // AX25 maximum digi, no call inserted in full path
+
+struct TFrameView {
+    uint8_t ascii;             // OE ASCII frame
+    uint8_t dest_end;          // ASCII: offset after dest call (',' or ':')
+    uint8_t mark;              // ASCII: offset of last '*', 0 if none
+    uint8_t hops;              // Number of path entry
+    uint8_t hop[VIEW_MAXHOP];  // Offset of each path entry
+    uint8_t unused;            // First unused path entry (hops if all used)
+    uint8_t data;              // Offset of data field
+    uint8_t data_len;          // Length of data field
+    unsigned char src[7];      // Source call, AX25 format
+} TFrameView;
+
+/* Duplicate frame table, open addressed on fingerprint */
+#if (DUP_MAXFRAME & (DUP_MAXFRAME-1)) != 0 || DUP_DELAY > 90
+#error "DUP_MAXFRAME must be power of 2 and DUP_DELAY under 90 sec"
+#endif
 
-/* Duplicate frame table */
 struct TDupFrame {
-    unsigned long time;    // Time when receive packet (if 0, empty slot)
-    uint16_t crc;          // CRC of data block
+    uint16_t crc;          // Fingerprint of source call and data block
+    uint8_t time;          // Low byte of wdt_clk when frame expire (if 0, empty slot)
 } TDupFrame;
 
-struct TDupFrame DupFrame[DUP_MAXFRAME];
+uint32_t DupSweepTimer;
+
+/* Heard stations table */
+#define HEARD_DIRECT 1
+#define HEARD_VIA    2
+
+struct THeard {
+    unsigned char call[7];  // Source call (AX25 format), empty slot if 0
+    uint32_t time;          // wdt_clk when last heard
+    uint32_t direct;        // wdt_clk when last heard direct
+    uint16_t count;         // Packet count
+    uint8_t rssi, rssi_avg; // Signal in -dBm, last direct copy
+    int8_t snr, snr_avg;    // SNR in dB, last direct copy
+    uint8_t flag;           // HEARD_DIRECT and/or HEARD_VIA
+} THeard;
+
+#if HEARD_MAX > 0
+struct THeard Heard[HEARD_MAX];
+
+/* Direct station rejected by RX filter, added to table by DigiPoll */
+struct THeardRx {
+    char call[10];          // AX25 call, or ASCII call up to '>' (null terminated)
+    uint8_t ascii;
+    uint8_t snr, rssi;      // Raw register value
+} THeardRx;
+
+volatile struct THeardRx HeardRx;
+volatile uint8_t HeardRxPending;
+#endif
+
+/* Per source airtime bucket (LRU) */
+struct TSrcRate {
+    unsigned char call[7];  // Source call (AX25 format, SSID masked), empty slot if 0
+    uint16_t tokens;        // Airtime left in ms
+    uint32_t time;          // wdt_clk of last refill
+    uint16_t throttled;     // Frame not digipeated
+} TSrcRate;
+
+#if SRC_RATE_MAX > 0
+struct TSrcRate SrcRate[SRC_RATE_MAX];
+#endif
+
+/* Beacon scheduler, one due time per beacon. Telemetry due in BCN_MERGE 
+   window ride in position comment, other position beacon is pushed after it */
+#define BCN_POS1   0       // Position beacon, B1_COMMENT
+#define BCN_POS2   1       // Position beacon, B2_COMMENT
+#define BCN_STATUS 2       // System status beacon
+#define BCN_TELEM  3       // T# telemetry frame
+#define BCN_META   4       // PARM/UNIT/EQNS telemetry metadata
+#define BCN_COUNT  5
+#define BCN_NEVER  0xFFFFFFFF
+
+uint32_t BeaconQueryTime;  // Last beacon triggered by query
+uint8_t BeaconQuery;       // Bit set by query (bit 0: beacon 1, bit 2: beacon 3), sent as query response
+
+/* Automatic frequency correction interval (offset kept in Keep) */
+uint32_t AfcTimer;
+
+/* Channel load from received airtime and CAD sample, busy ratio in 1/255 
+   (average on some CHANNEL_LOAD_INTERVAL window), set persistance and slottime */
+volatile uint32_t ChannelRxMs;     // Airtime of frame received in current window (DIO0 IRQ)
+uint8_t ChannelCad, ChannelCadBusy;  // CAD sample in current window
+uint8_t ChannelLoad;
+uint8_t ChannelPersist;            // From Config[CFG_PERSIST], see ChannelBackoff()
+uint16_t ChannelSlot;              // From Config[CFG_SLOT]
+uint32_t ChannelTimer;
+
+/* Airtime used in last hour, 6 slots of 10 minutes in unit of 10ms */
+uint16_t AirtimeSlot[6];
+uint8_t AirtimeIndex;
+uint32_t AirtimeTimer;     // Time to start next slot
+
+/* State kept across watchdog reset, in .noinit RAM (not cleared by startup 
+   code). DigiSeal() set magic and CRC just before the reset, DigiInit() 
+   restore it and rebase timer. Cleared on power-on, brown-out or external 
+   reset, or if not sealed. Frame and schedule state are not restored after
+   a hang */
+#define KEEP_MAGIC 0x4B44
+#define KEEP_LOG   4
+
+struct TKeep {
+    uint16_t magic;
+    uint32_t clk;                       // wdt_clk when sealed
+    struct TDupFrame DupFrame[DUP_MAXFRAME];
+    uint32_t BeaconTime[BCN_COUNT];     // Value of wdt_clk for next transmission
+    uint32_t MetaInterval;              // Metadata interval, doubled up to BCN_META_MAX
+    uint8_t MetaIndex;                  // Next metadata frame (0: PARM, 1: UNIT, 2: EQNS)
+    uint8_t TelemCount;                 // T# or base 91 sequence
+    int16_t AfcOffset;                  // Automatic frequency correction, in Hz from FREQ_ERR
+
+    // STAT
+    unsigned int stat_rx_pkt, stat_digipeated_pkt, stat_tx_pkt;
+    unsigned int stat_oe_pkt, stat_bin_pkt;  
+    unsigned int stat_tx_drop;              // Queued frame dropped (deadline or airtime budget)
+    #if VISCOUS_DELAY > 0
+    unsigned int stat_visc_held, stat_visc_cancel, stat_visc_sent;
+    #endif
+    #if SRC_RATE_MAX > 0
+    unsigned int stat_throttled;
+    #endif
+
+    char cause;                         // Reset cause set by DigiSeal() (D: daily, H: hang)
+    uint16_t crc;
+} TKeep;
+
+struct TKeep Keep __attribute__((section(".noinit")));
+
+/* Reset log, in .noinit RAM apart from Keep: kept across any reset while RAM
+   stay powered, cleared only when CRC is bad (RAM lost) */
+struct TResetLog {
+    uint16_t boots;                     // Reset since log was cleared
+    char cause[KEEP_LOG];               // Newest first, P: power-on, B: brown-out, E: external, W: watchdog, D: daily, H: hang
+    uint16_t crc;
+} TResetLog;
+
+struct TResetLog ResetLog __attribute__((section(".noinit")));
+
+/* Worst case RAM of static buffer: frame pool, radio RX queue, kept state (duplicate) and heard table */
+static_assert(FRAME_SIZE >= (SX1278_RXQ_SIZE - 3 < 255 ? SX1278_RXQ_SIZE - 3 : 255), "Frame from RX queue must fit in FRAME_SIZE");
+static_assert(sizeof(Frame) + sizeof(SX1278) + sizeof(Keep) + sizeof(ResetLog) + HEARD_MAX*sizeof(struct THeard) 
+              + SRC_RATE_MAX*sizeof(struct TSrcRate) + RAM_RESERVE <= RAMEND - RAMSTART + 1, "RAM budget exceeded, reduce FRAME_POOL, FRAME_SIZE, HEARD_MAX, SRC_RATE_MAX or DUP_MAXFRAME");
+
+
+/******************************************************************************
+ * void StackPaint()
+ * uint16_t StackFree()
+ *
+ * Free RAM between end of static (__heap_start, .noinit is last) and stack 
+ * is painted at boot, StackFree() count byte still painted: least free stack
+ * since boot, shown in status beacon. A stack overflow first hit .noinit, 
+ * Keep and reset log CRC reject it.
+ ******************************************************************************/
+#ifdef __AVR__
+#define STACK_PAINT 0xC5
+extern uint8_t __heap_start;
+
+void StackPaint() {
+    uint8_t *p = &__heap_start;
 
-/* Beacon timer */
-uint32_t Beacon1Timer;     // Value of Timer for next beacon transmission
-uint32_t Beacon2Timer; 
-uint32_t Beacon3Timer;     // System beacon (Version and up-time)
-uint32_t TelemTimer;       // Telemetry timer 
+    while(p < (uint8_t*)SP) *p++ = STACK_PAINT;
+}
 
-// STAT
-unsigned int stat_rx_pkt, stat_digipeated_pkt, stat_tx_pkt;
-unsigned int stat_oe_pkt, stat_bin_pkt;  
+uint16_t StackFree() {
+    uint8_t *p = &__heap_start;
 
+    while(p <= (uint8_t*)RAMEND && *p == STACK_PAINT) p++;
+    return p - &__heap_start;
+}
+#endif
 
 /******************************************************************************
  * Check timer overflow
@@ -41,28 +265,243 @@ bool TimerOverflow(unsigned long value)
 
 
 /******************************************************************************
- * Watch clear channel, 100ms slottime, persistance 63.
+ * Airtime budget
+ * 
+ * AirtimeUsed() return sec of transmit time in last hour, AirtimeAvailable()
+ * return true if airtime used is under pct % of budget.
  *****************************************************************************/
+uint32_t AirtimeUsed() {
+    uint32_t sum = 0;
+
+    /* START NEW SLOT EACH 10 MINUTES, CLEAR OLDEST */
+    while(TimerOverflow(AirtimeTimer)) {
+        AirtimeTimer += 600;
+        if(++AirtimeIndex >= 6) AirtimeIndex = 0;
+        AirtimeSlot[AirtimeIndex] = 0;
+    }
+    
+    for(uint8_t i=0; i<6; i++) sum += AirtimeSlot[i];
+    return sum / 100;
+}
+
+bool AirtimeAvailable(uint8_t pct) {
+    return AirtimeUsed() < (uint32_t)AIRTIME_BUDGET * pct / 100;
+}
+
+
+/******************************************************************************
+ * Sleep CPU until DIO0 rise (or next watchdog tick). Check pin with
+ * interrupt disabled so edge can't be missed before sleeping.
+ *****************************************************************************/
+void SleepUntilDio() {
+    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+    cli();
+    if(digitalRead(LORA_DIO) == LOW) {
+        sleep_enable();
+        sei();
+        sleep_cpu();
+        sleep_disable();
+    }
+    sei();
+}
+
+
+/******************************************************************************
+ * void AfcUpdate()
+ *
+ * Follow crystal drift with enclosure temperature: move radio frequency to
+ * average frequency error measured on received packet, in AFC_MAX limit.
+ *****************************************************************************/
+#if AFC_ENABLE==1
+void AfcUpdate() {
+    int32_t err;
+
+    if(!TimerOverflow(AfcTimer)) return;
+    AfcTimer = wdt_clk + AFC_INTERVAL;
+    if(lora.getFeiCount() < AFC_MIN_PKT) return;
+
+    err = lora.getFrequencyError();
+    lora.clearFrequencyError();
+    if(labs(err) < AFC_DEADBAND) return;
+
+    /* NEW OFFSET, IN SAFE BOUND */
+    err += Keep.AfcOffset;
+    if(err > AFC_MAX) err = AFC_MAX;
+    if(err < -AFC_MAX) err = -AFC_MAX;
+    Keep.AfcOffset = err;
+
+    /* SET FREQUENCY AND DATA RATE CORRECTION, RESTART RECEIVER */
+    lora.setMode(SX1278_STANDBY);
+    lora.setFrequency((FREQ * 1000000.0) + FREQ_ERR + Keep.AfcOffset);
+    lora.setPpmError(lround(0.95 * ((FREQ_ERR + Keep.AfcOffset) / FREQ)));
+    lora.startReceive();
+}
+#endif
+
+
+/******************************************************************************
+ * Channel load
+ * 
+ * Each window, busy ratio is received airtime over window time, averaged with
+ * busy CAD ratio if any CAD was done. Load is filtered (1/4 new sample) and
+ * scale persistance and slottime between bound: busy channel get lower 
+ * persistance and longer slot, quiet channel transmit sooner.
+ *
+ * ChannelBackoff() set persistance and slottime from Config[]. When adaptive,
+ * PS and SL are quiet channel value, full backoff go to CHANNEL_PERSIST_MIN 
+ * and CHANNEL_SLOTTIME_MAX (or stay at PS and SL if already beyond).
+ *****************************************************************************/
+void ChannelBackoff() {
+    ChannelPersist = Config[CFG_PERSIST];
+    ChannelSlot = Config[CFG_SLOT];
+
+    #if CHANNEL_ADAPTIVE==1
+    uint16_t scale;
+
+    /* FULL BACKOFF AT CHANNEL_LOAD_FULL % BUSY */
+    scale = (uint16_t)ChannelLoad * 100 / Config[CFG_LOADFULL];
+    if(scale > 255) scale = 255;
+    if(ChannelPersist > CHANNEL_PERSIST_MIN) ChannelPersist -= (uint16_t)(ChannelPersist - CHANNEL_PERSIST_MIN) * scale / 255;
+    if(ChannelSlot < CHANNEL_SLOTTIME_MAX) ChannelSlot += (uint32_t)(CHANNEL_SLOTTIME_MAX - ChannelSlot) * scale / 255;
+    #endif
+}
+
+#if CHANNEL_ADAPTIVE==1
+void ChannelLoadUpdate() {
+    uint32_t ms;
+    uint16_t sample;
+
+    if(!TimerOverflow(ChannelTimer)) return;
+    ChannelTimer = wdt_clk + CHANNEL_LOAD_INTERVAL;
+
+    /* TAKE WINDOW COUNTER */
+    cli();
+    ms = ChannelRxMs;
+    ChannelRxMs = 0;
+    sei();
+    sample = ms * 255 / (CHANNEL_LOAD_INTERVAL * 1000UL);
+    if(sample > 255) sample = 255;
+    if(ChannelCad) sample = (sample + (uint16_t)ChannelCadBusy * 255 / ChannelCad) / 2;
+    ChannelCad = 0;
+    ChannelCadBusy = 0;
+    ChannelLoad = (3 * (uint16_t)ChannelLoad + sample + 2) / 4;
+    ChannelBackoff();
+}
+#endif
+
+
+/******************************************************************************
+ * Watch clear channel, slottime and persistance from channel load.
+ *
+ * With CAD, each slot start with a channel activity detection (CPU in power
+ * down until CadDone), then receiver listen for the rest of the slot with 
+ * CPU in idle mode. Frame received during that time are queued by DIO0 IRQ.
+ *****************************************************************************/
+#if CHANNEL_CAD_ENABLE==1
+uint8_t ChannelBusy() {
+
+    /* RECEPTION ALREADY IN PROGRESS */
+    if(lora.rxBusy()) return 1;
+
+    /* LOOK FOR PREAMBLE */
+    lora.cadStart();
+    while(lora.cadBusy()) SleepUntilDio();
+    lora.startReceive();
+    if(ChannelCad < 255) {
+        ChannelCad++;
+        if(lora.cadDetected()) ChannelCadBusy++;
+    }
+    return lora.cadDetected();
+}
+
+void WaitClearChannel() {
+    uint32_t t;
+
+    while(1) {
+        if(!ChannelBusy() && random(0,256) <= ChannelPersist) return;
+
+        /* WAIT ONE SLOT, RECEIVER ON */
+        t = wdt_millis() + ChannelSlot;
+        set_sleep_mode(SLEEP_MODE_IDLE);
+        while((int32_t)(wdt_millis() - t) < 0) sleep_mode();
+    }
+}
+#else
 void WaitClearChannel() {
     uint32_t t;
 
     do {
-        t = millis() + CHANNEL_SLOTTIME;      
+        t = wdt_millis() + ChannelSlot;      
         do {
-            if(lora.rxBusy()) t = millis() + CHANNEL_SLOTTIME;      
-        } while(millis() < t);          
-    } while(random(0,256) > CHANNEL_PERSIST);
+            if(lora.rxBusy()) t = wdt_millis() + ChannelSlot;      
+        } while(wdt_millis() < t);          
+    } while(random(0,256) > ChannelPersist);
 }
+#endif
 
 
 /******************************************************************************
- * Packet handling fonction
+ * void Transmit(uint8_t *buf, uint8_t size)
  * 
- * Create and manage packet.
+ * Wait channel to be clear and send frame. CPU stay in power down for the
+ * whole airtime, TX_DONE on DIO0 wake it. Receiver restart after.
  *****************************************************************************/
-void CreatePacket() {
+void Transmit(uint8_t *buf, uint8_t size) {
+    AirtimeUsed();      // Rotate slot before adding
+    AirtimeSlot[AirtimeIndex] += (lora.timeOnAir(size) + 5) / 10;
+    WaitClearChannel();
+    lora.tx(buf, size);
+    while(lora.txBusy()) SleepUntilDio();
+    lora.startReceive();
+}
+
+
+/******************************************************************************
+ * Frame pool
+ * 
+ * Take a free slot for owner, return 0 if pool is full.
+ *****************************************************************************/
+struct TFrame *FrameAlloc(uint8_t owner) {
     uint8_t i;
+
+    for(i=0; i<FRAME_POOL; i++) {
+        if(Frame[i].owner == FRAME_FREE) {
+            Frame[i].owner = owner;
+            Frame[i].len = 0;
+            return &Frame[i];
+        }
+    }
+    return 0;
+}
+
+void FrameFree(struct TFrame *f) {
+    f->owner = FRAME_FREE;
+}
+
+
+/******************************************************************************
+ * Packet handling fonction
+ * 
+ * Create and manage packet. Frame is built in a TX slot, directly in ASCII 
+ * or binary format, choose format the most used on network around.
+ * Return false if no free slot.
+ *****************************************************************************/
+bool CreatePacket() {
             
+    TxFrame = FrameAlloc(FRAME_TX);
+    if(TxFrame == 0) return false;
+    pkt = TxFrame->buf;
+
+    /* ASCII HEADER: < 0xFF 0x01 SRC>DEST,PATH: */
+	#if OE_TYPE_PACKET_ENABLE==1
+    if(Keep.stat_oe_pkt>=Keep.stat_bin_pkt) {
+        index = sprintf_P((char*)pkt, PSTR("<\xFF\x01%s>%s"), MYCALL, BCN_DEST);
+        if(strlen(BCN_PATH)!=0) index += sprintf_P((char*)&pkt[index], PSTR(",%s"), BCN_PATH);
+        pkt[index++] = ':';
+        return true;
+    }
+	#endif
+
     /* SEND SOURCE/DEST CALLSIGN */  
     index=0;
     asc2AXcall(BCN_DEST, &pkt[index]); 
@@ -79,340 +518,1058 @@ void CreatePacket() {
     pkt[index-1] |= 1;  // Finalize path here
     pkt[index++] = 0x03;    /* UI Frame */
     pkt[index++] = 0xF0;    /* PID */                                                      
+    return true;
 }
 
 
 /******************************************************************************
- * void SendPacket()
+ * Transmit queue
  * 
- * Wait channel to be clear and send packet.
+ * Queued frame stay in their pool slot. Highest priority class is sent first,
+ * oldest first in same class. Frame not sent before deadline are dropped, a
+ * digipeat must not be sent after other digi have forgot it. When airtime
+ * budget is exhausted digipeat is dropped, other frame (beacon, ack, reply)
+ * is held until next budget slot or its deadline. Drop are counted.
  *****************************************************************************/
-void SendPacket() {
+void TxEnqueue(struct TFrame *f, uint8_t len, uint8_t prio) {
+    f->owner = FRAME_QUEUED;
+    f->len = len;
+    f->prio = prio;
+    f->hold = wdt_clk;
+    f->deadline = wdt_clk + (prio <= TXQ_ACK ? TXQ_DIGI_MAXAGE : TXQ_MAXAGE);
+}
 
-	/* SEND IN ASCII OR BINARY, CHOOSE FORMAT THE MOST USED ON NETWORK AROUND */
-	#if OE_TYPE_PACKET_ENABLE==1
-    if(stat_oe_pkt>=stat_bin_pkt) {
-		char *buf = (char*)malloc(256);
-		if(buf) {
-			buf[0] = '<'; 
-			buf[1] = 0xFF; 
-			buf[2] = 0x01; 			
-			DecodeAX25(pkt, index, &buf[3]);
-			WaitClearChannel();
-			lora.tx((uint8_t*)buf, strlen(&buf[3])+3);
-			while(lora.txBusy());
-			stat_tx_pkt++;
-			free(buf);
-			return;
-		}
-	}
-	#endif
-	
-	/* WAIT CHANNEL CLEAR AND SEND BEACON */
-    WaitClearChannel();
-    lora.tx(pkt, index);
-    while(lora.txBusy());
-    stat_tx_pkt++;
+/* SEND ONE FRAME, RETURN 0 IF QUEUE IS EMPTY */
+uint8_t TxQueueService() {
+    struct TFrame *f = 0;
+    uint8_t i;
+
+    for(i=0; i<FRAME_POOL; i++) {
+        if(Frame[i].owner != FRAME_QUEUED) continue;
+        if(TimerOverflow(Frame[i].deadline)) {        // Too old, drop it
+            FrameFree(&Frame[i]);
+            Keep.stat_tx_drop++;
+            continue;
+        }
+        if(wdt_clk < Frame[i].hold) continue;          // Held digipeat
+        if(f == 0 || Frame[i].prio < f->prio || (Frame[i].prio == f->prio && Frame[i].deadline < f->deadline)) f = &Frame[i];
+    }
+    if(f == 0) return 0;
+
+    /* NO AIRTIME LEFT, HOLD OWN FRAME UNTIL SLOT ROTATE (OR DEADLINE), DROP DIGIPEAT */
+    if(!AirtimeAvailable(100)) {
+        if(f->prio != TXQ_DIGI) {
+            f->hold = (AirtimeTimer < f->deadline ? AirtimeTimer : f->deadline) + 1;
+            return 1;
+        }
+        Keep.stat_tx_drop++;
+        FrameFree(f);
+        return 1;
+    }
+
+	/* WAIT CHANNEL CLEAR AND SEND */
+    Transmit(f->buf, f->len);
+    if(f->prio == TXQ_DIGI) {
+        Keep.stat_digipeated_pkt++;
+        #if VISCOUS_DELAY > 0
+        Keep.stat_visc_sent++;
+        #endif
+    }
+    else Keep.stat_tx_pkt++;
+    FrameFree(f);
+    return 1;
+}
+
+
+/******************************************************************************
+ * void SendPacket(uint8_t prio)
+ * 
+ * Queue packet under construction in prio class, DigiPoll() send it.
+ *****************************************************************************/
+void SendPacket(uint8_t prio) {
+
+    if(TxFrame == 0) return;
+    TxEnqueue(TxFrame, index, prio);
+    TxFrame = 0;
+}
+
+
+/******************************************************************************
+ * Telemetry value, 8 bits scaled as in EQNS of telemetry parameter
+ *****************************************************************************/
+void TelemRead(uint8_t *param) {
+    param[0] = ((float)batt_volt/1000.0 - 2.5) / 0.008;
+    param[1] = (ext_temp + 60.0) / 0.5;
+    param[2] = (int_temp + 60.0) / 0.5;
+    param[3] = (pressure - 90.0) * 10.0;    // Pressure range 90-115 in 0.1 step
+    param[4] = 0;
+    #if AFC_ENABLE==1
+    param[4] = constrain(Keep.AfcOffset / 100 + 128, 0, 255); // AFC in 100 Hz step, +/-12.8 kHz
+    #elif CHANNEL_ADAPTIVE==1
+    param[4] = ChannelLoad;                              // Channel busy in 1/255
+    #endif
 }
 
 
 /******************************************************************************
- * void DigiSendBeacon(uint8_t id)
+ * Base 91 compressed position and telemetry (APRS 1.01 chapter 9 and 
+ * telemetry extension |ss1122334455|), write caracter to out and return 
+ * length.
+ *****************************************************************************/
+void Base91(char *out, uint32_t value, uint8_t n) {
+    while(n--) {
+        out[n] = 33 + value % 91;
+        value /= 91;
+    }
+}
+
+#if BCN_COMPRESSED==1
+
+/* BCN_POSITION "!DDMM.mmN/DDDMM.mmWa" TO "!/YYYYXXXXa  !" */
+uint8_t BcnCompressed(char *out) {
+    char pos[21];
+    float lat, lon;
+
+    strncpy_P(pos, BCN_POSITION, 20);
+    pos[20] = 0;
+    lat = (pos[1]-'0')*10 + (pos[2]-'0') + atof(&pos[3]) / 60.0;
+    if(pos[8] == 'S') lat = -lat;
+    lon = (pos[10]-'0')*100 + (pos[11]-'0')*10 + (pos[12]-'0') + atof(&pos[13]) / 60.0;
+    if(pos[18] == 'W') lon = -lon;
+
+    out[0] = pos[0];
+    out[1] = isdigit(pos[9]) ? 'a' + pos[9] - '0' : pos[9];   // Overlay 0-9 are a-j
+    Base91(&out[2], 380926.0 * (90.0 - lat), 4);
+    Base91(&out[6], 190463.0 * (180.0 + lon), 4);
+    out[10] = pos[19];
+    strcpy_P(&out[11], PSTR("  !"));                             // No course/speed/range
+    return 14;
+}
+#endif
+
+#if VOLT_ENABLE==1 || BMP180_ENABLE==1 || DS_ENABLE==1
+uint8_t TelemBase91(char *out) {
+    uint8_t i, param[5];
+
+    TelemRead(param);
+    out[0] = '|';
+    Base91(&out[1], Keep.TelemCount++, 2);
+    for(i=0; i<5; i++) Base91(&out[3+2*i], param[i], 2);
+    strcpy_P(&out[13], PSTR("|"));
+    return 14;
+}
+#endif
+
+
+/******************************************************************************
+ * bool DigiSendBeacon(uint8_t id, bool telem)
  * 
- * Create and send digipeater beacon to Lora radio.
+ * Create and send digipeater beacon to Lora radio, with telemetry in 
+ * position comment if telem is set. Return false if no frame available.
  *****************************************************************************/
-void DigiSendBeacon(uint8_t id) {
+bool DigiSendBeacon(uint8_t id, bool telem) {
+    uint8_t prio = (BeaconQuery & (1<<id)) ? TXQ_QUERY : TXQ_BEACON;
 
     /* CREATE NEW PACKET */
-    CreatePacket();
+    if(!CreatePacket()) return false;
     
     /* SYSTEM STATUS BEACON */
     if(id == 2) {
         char tmp[6];
         dtostrf(ext_temp, 5, 1, tmp);
-        index += sprintf((char*)&pkt[index], ">%umV (%s) T=%sC R%uD%uT%u", batt_volt, sleep_flag?"SLP":"ACT", tmp, stat_rx_pkt, stat_digipeated_pkt, stat_tx_pkt);
+        index += sprintf_P((char*)&pkt[index], PSTR(">%umV (%s) T=%sC R%uD%uT%u A%u"), batt_volt, sleep_flag?"SLP":"ACT", tmp, Keep.stat_rx_pkt, Keep.stat_digipeated_pkt, Keep.stat_tx_pkt, (unsigned int)AirtimeUsed());
+        #if VISCOUS_DELAY > 0
+        index += sprintf_P((char*)&pkt[index], PSTR(" V%u/%u/%u"), Keep.stat_visc_held, Keep.stat_visc_cancel, Keep.stat_visc_sent);
+        #endif
+
+        /* QUEUED FRAME DROPPED */
+        if(Keep.stat_tx_drop) index += sprintf_P((char*)&pkt[index], PSTR(" X%u"), Keep.stat_tx_drop);
+
+        /* CHANNEL BUSY %, PERSISTANCE AND SLOTTIME */
+        #if CHANNEL_ADAPTIVE==1
+        index += sprintf_P((char*)&pkt[index], PSTR(" C%u%%P%uS%u"), (ChannelLoad * 100 + 127) / 255, ChannelPersist, ChannelSlot);
+        #endif
+
+        /* RESET COUNT AND LAST CAUSE */
+        if(ResetLog.boots) index += sprintf_P((char*)&pkt[index], PSTR(" B%u%.*s"), ResetLog.boots, KEEP_LOG, ResetLog.cause);
+
+        /* LEAST FREE STACK SINCE BOOT */
+        #ifdef __AVR__
+        index += sprintf_P((char*)&pkt[index], PSTR(" F%u"), StackFree());
+        #endif
+
+        /* THROTTLED FRAME AND TOP OFFENDER */
+        #if SRC_RATE_MAX > 0
+        if(Keep.stat_throttled) {
+            uint8_t i, top = 0;
+            for(i=1; i<SRC_RATE_MAX; i++) if(SrcRate[i].throttled > SrcRate[top].throttled) top = i;
+            index += sprintf_P((char*)&pkt[index], PSTR(" L%u"), Keep.stat_throttled);
+            if(SrcRate[top].throttled) index += sprintf_P((char*)&pkt[index], PSTR(" %s:%u"), AXCall2asc(SrcRate[top].call), SrcRate[top].throttled);
+        }
+        #endif
     } else {
       
         /* LATITUDE, TABLE/OVERLAY, LONGITUDE AND SYMBOL */
+        #if BCN_COMPRESSED==1
+        index += BcnCompressed((char*)&pkt[index]);
+        #else
         index += sprintf_P((char*)&pkt[index], BCN_POSITION);  		// YAG-4 test site
+        #endif
  
         /* COMMENT */
         switch(id) {
             case 0:  index += sprintf_P((char*)&pkt[index], B1_COMMENT);  break; 
             case 1:  index += sprintf_P((char*)&pkt[index], B2_COMMENT); break; 
         }
+
+        /* TELEMETRY IN COMMENT, REPLACE T# FRAME */
+        #if VOLT_ENABLE==1 || BMP180_ENABLE==1 || DS_ENABLE==1
+        if(telem) index += TelemBase91((char*)&pkt[index]);
+        #endif
     }
 
-    SendPacket();
+    SendPacket(prio);
+    return true;
 }
 
 
 /******************************************************************************
- * void DigiSendTelem()
+ * bool DigiSendTelem()
  * 
- * Send telemetry to radio.
+ * Send T# telemetry frame to radio. Return false if no frame available.
  *****************************************************************************/
-void DigiSendTelem() {
-    uint8_t i, spc_count;
-    static unsigned char seq,seq_cnt;    
-    
-     /* CREATE NEW PACKET */
-    CreatePacket();
- 
-    /* CREATE APRS MESSAGE HEADER ONLY FOR TELEMETRY PARAMETERS */
-    if(TelemSequence[seq]!=1) index += sprintf((char*)&pkt[index], ":%-9s:", MYCALL);
-     
-    /* FINISH TELEM PACKET */
-    uint8_t param1 = ((float)batt_volt/1000.0 - 2.5) / 0.008;
-    uint8_t param2 = (ext_temp + 60.0) / 0.5;
-    uint8_t param3 = (int_temp + 60.0) / 0.5;
-    uint8_t param4 = (pressure - 90.0) * 10.0;    // Pressure range 90-115 in 0.1 step
-    
-    switch(TelemSequence[seq++]) {
-        case 1:  index += sprintf_P((char*)&pkt[index], PSTR("T#%03u,%03u,%03u,%03u,%03u,000,00000000"), seq_cnt++, param1, param2, param3, param4);  break; 
-        case 2:  index += sprintf_P((char*)&pkt[index], PSTR("PARM.Vbatt,ExtT,IntT,Pres")); break;
-        case 3:  index += sprintf_P((char*)&pkt[index], PSTR("UNIT.Volt,C,C,kPa")); break;
-        case 4:  index += sprintf_P((char*)&pkt[index], PSTR("EQNS.0,0.008,2.5,0,0.5,-60,0,0.5,-60,0,0.1,90")); break;
+#if VOLT_ENABLE==1 || BMP180_ENABLE==1 || DS_ENABLE==1
+bool DigiSendTelem() {
+    uint8_t param[5];
+
+    /* CREATE NEW PACKET */
+    if(!CreatePacket()) return false;
+
+    TelemRead(param);
+    index += sprintf_P((char*)&pkt[index], PSTR("T#%03u,%03u,%03u,%03u,%03u,%03u,00000000"), Keep.TelemCount++, param[0], param[1], param[2], param[3], param[4]);
+    SendPacket(TXQ_TELEM);
+    return true;
+}
+
+
+/******************************************************************************
+ * bool DigiSendMeta(uint8_t id)
+ * 
+ * Send telemetry PARM (0), UNIT (1) or EQNS (2) message to radio. Return 
+ * false if no frame available.
+ *****************************************************************************/
+bool DigiSendMeta(uint8_t id) {
+
+    /* CREATE NEW PACKET, MESSAGE TO OURSELF */
+    if(!CreatePacket()) return false;
+    index += sprintf_P((char*)&pkt[index], PSTR("%s"), MsgHeader);
+
+    switch(id) {
+        #if AFC_ENABLE==1
+        case 0:  index += sprintf_P((char*)&pkt[index], PSTR("PARM.Vbatt,ExtT,IntT,Pres,AFC")); break;
+        case 1:  index += sprintf_P((char*)&pkt[index], PSTR("UNIT.Volt,C,C,kPa,kHz")); break;
+        case 2:  index += sprintf_P((char*)&pkt[index], PSTR("EQNS.0,0.008,2.5,0,0.5,-60,0,0.5,-60,0,0.1,90,0,0.1,-12.8")); break;
+        #elif CHANNEL_ADAPTIVE==1
+        case 0:  index += sprintf_P((char*)&pkt[index], PSTR("PARM.Vbatt,ExtT,IntT,Pres,Busy")); break;
+        case 1:  index += sprintf_P((char*)&pkt[index], PSTR("UNIT.Volt,C,C,kPa,%%")); break;
+        case 2:  index += sprintf_P((char*)&pkt[index], PSTR("EQNS.0,0.008,2.5,0,0.5,-60,0,0.5,-60,0,0.1,90,0,0.392,0")); break;
+        #else
+        case 0:  index += sprintf_P((char*)&pkt[index], PSTR("PARM.Vbatt,ExtT,IntT,Pres")); break;
+        case 1:  index += sprintf_P((char*)&pkt[index], PSTR("UNIT.Volt,C,C,kPa")); break;
+        case 2:  index += sprintf_P((char*)&pkt[index], PSTR("EQNS.0,0.008,2.5,0,0.5,-60,0,0.5,-60,0,0.1,90")); break;
+        #endif
+    }
+
+    SendPacket(TXQ_TELEM);
+    return true;
+}
+#endif
+
+
+/******************************************************************************
+ * Beacon scheduler
+ * 
+ * BeaconSchedule() set next due time of beacon with random jitter, so 
+ * beacons don't stay grouped after query or reboot. BeaconQueryTrigger() 
+ * bring beacon forward on query, limited to one each BCN_QUERY_MIN. 
+ * BeaconService() send one due beacon, return 1 if one is queued.
+ *****************************************************************************/
+void BeaconSchedule(uint8_t id) {
+    Keep.BeaconTime[id] = wdt_clk + Config[CFG_B1 + id] + random(-BCN_JITTER, BCN_JITTER + 1);
+    BeaconQuery &= ~(1<<id);
+}
+
+void BeaconQueryTrigger(uint8_t id) {
+    if(BeaconQueryTime && wdt_clk - BeaconQueryTime < BCN_QUERY_MIN) return;
+    BeaconQueryTime = wdt_clk;
+    Keep.BeaconTime[id] = wdt_clk + random(0, BCN_QUERY_DELAY + 1);
+    BeaconQuery |= (1<<id);
+}
+
+uint8_t BeaconService() {
+    uint8_t i, due = 0;
+    bool telem = false;
+
+    for(i=0; i<BCN_COUNT; i++) if(TimerOverflow(Keep.BeaconTime[i])) due |= (1<<i);
+    if(due == 0) return 0;
+
+    /* AIRTIME BUDGET LOW, DEFER ALL DUE BEACON */
+    if(!AirtimeAvailable(AIRTIME_LOW_PCT)) {
+        for(i=0; i<BCN_COUNT; i++) if(due & (1<<i)) Keep.BeaconTime[i] = wdt_clk + AIRTIME_DEFER;
+        return 0;
+    }
+
+    /* POSITION, ONE FRAME FOR BEACON AND TELEMETRY DUE IN MERGE WINDOW. OTHER 
+       POSITION BEACON IS NOT MERGED (BOTH COMMENT DON'T FIT IN 43 CHAR), 
+       PUSHED OUT OF WINDOW SO IT KEEP ITS OWN COMMENT */
+    if(due & ((1<<BCN_POS1) | (1<<BCN_POS2))) {
+        uint8_t id = (due & (1<<BCN_POS1)) ? BCN_POS1 : BCN_POS2;
+        uint8_t other = BCN_POS1 + BCN_POS2 - id;
+        #if VOLT_ENABLE==1 || BMP180_ENABLE==1 || DS_ENABLE==1
+        if(Keep.BeaconTime[BCN_TELEM] < wdt_clk + BCN_MERGE) telem = true;
+        #endif
+        #if BCN_COMPRESSED==1
+        telem = true;                   // T# never sent, telemetry always in position
+        #endif
+
+        if(!DigiSendBeacon(id, telem)) return 0;
+        BeaconSchedule(id);
+        if(Keep.BeaconTime[other] < wdt_clk + BCN_MERGE) Keep.BeaconTime[other] = wdt_clk + BCN_MERGE;
+        #if BCN_COMPRESSED==0
+        if(telem) BeaconSchedule(BCN_TELEM);
+        #endif
+        return 1;
+    }
+
+    /* SYSTEM STATUS */
+    if(due & (1<<BCN_STATUS)) {
+        if(!DigiSendBeacon(2, false)) return 0;
+        BeaconSchedule(BCN_STATUS);
+        return 1;
+    }
+
+    #if VOLT_ENABLE==1 || BMP180_ENABLE==1 || DS_ENABLE==1
+    /* T# TELEMETRY, NO POSITION BEACON DUE NEAR */
+    if(due & (1<<BCN_TELEM)) {
+        if(!DigiSendTelem()) return 0;
+        BeaconSchedule(BCN_TELEM);
+        return 1;
     }
 
-    /* RESET SEQUENCE AT END AND SET FINAL PACKET SIZE */
-    if(TelemSequence[seq]==0) seq=0;
+    /* METADATA, 3 FRAMES SPACED, THEN INTERVAL DOUBLED UP TO BCN_META_MAX */
+    if(due & (1<<BCN_META)) {
+        if(!DigiSendMeta(Keep.MetaIndex)) return 0;
+        if(++Keep.MetaIndex < 3) {
+            Keep.BeaconTime[BCN_META] = wdt_clk + BCN_META_SPACING;
+        } else {
+            Keep.MetaIndex = 0;
+            Keep.BeaconTime[BCN_META] = wdt_clk + Keep.MetaInterval;
+            Keep.MetaInterval *= 2;
+            if(Keep.MetaInterval > BCN_META_MAX) Keep.MetaInterval = BCN_META_MAX;
+        }
+        return 1;
+    }
+    #endif
 
-    SendPacket();
+    return 0;
 }
 
 
 /******************************************************************************
  * unsigned short DoCRC(unsigned short crc, unsigned char c)
  * 
- * Compute CRC.
+ * Compute CRC-16 (0x8408 reflected), one nibble at a time with table.
  *****************************************************************************/
+const uint16_t CrcTable[16] PROGMEM = {
+    0x0000, 0x1081, 0x2102, 0x3183, 0x4204, 0x5285, 0x6306, 0x7387,
+    0x8408, 0x9489, 0xA50A, 0xB58B, 0xC60C, 0xD68D, 0xE70E, 0xF78F
+};
+
 unsigned short DoCRC(unsigned short crc, unsigned char c) {
-    unsigned short xor_int;
+    crc = (crc >> 4) ^ pgm_read_word(&CrcTable[(crc ^ c) & 0x0F]);
+    crc = (crc >> 4) ^ pgm_read_word(&CrcTable[(crc ^ (c >> 4)) & 0x0F]);
+    return crc;
+}
 
-    for (uint8_t i=0; i<8; i++) {       
-        xor_int = crc ^ (c&1);
-        crc>>=1;
-        if(xor_int & 0x0001) crc ^= 0x8408;
-        c >>=1;                  
-    }
 
+/******************************************************************************
+ * uint16_t Fingerprint(unsigned char *call, unsigned char *p, int size)
+ * 
+ * CRC of source call (AX25 format) and data block, path is not included. 
+ * Computed once per frame for duplicate test and insert.
+ *****************************************************************************/
+uint16_t Fingerprint(unsigned char *call, unsigned char *p, int size) {
+    uint16_t crc = 0xFFFF;
+
+    for(uint8_t i=0; i<6; i++) crc = DoCRC(crc, call[i]);
+    crc = DoCRC(crc, call[6] & 0x1E);
+    for(int i=0; i<size; i++) crc = DoCRC(crc, p[i]);
     return crc;
 }
 
 
 /******************************************************************************
-* TestDup
+* Duplicate table
 *
-* Return TRUE if packet given is already in duplicate table. Clear also old
-* frame.
+* Fingerprint hash give first slot, only DUP_PROBE slots are checked so test
+* and insert take constant time. Expire time is keeped on 8 bits, DupSweep()
+* clear expired slot before low byte of wdt_clk wrap around. DupSweep() is 
+* not called in battery sleep, DigiWake() clear the table.
 ******************************************************************************/
-int TestDup(unsigned char *p, int size) {
-    uint8_t i,flag;
-    uint16_t pkt_crc=0xFFFF;
+bool DupAlive(uint8_t slot) {
+    return Keep.DupFrame[slot].time != 0 && (int8_t)(Keep.DupFrame[slot].time - (uint8_t)wdt_clk) > 0;
+}
+
+void DupSweep() {
+    if(!TimerOverflow(DupSweepTimer)) return;
+    DupSweepTimer = wdt_clk + 30;
+    for(uint8_t i=0; i<DUP_MAXFRAME; i++) if(!DupAlive(i)) Keep.DupFrame[i].time = 0;
+}
 
-    /* COMPUTE CRC*/
-    for(i=0; i<size; i++) pkt_crc = DoCRC(pkt_crc, p[i]);
-    
-    /* CHECK FOR DUPLICATE, CLEAR OLD FRAME */
-    for(i=0,flag=0; i<DUP_MAXFRAME; i++) {
-        if(TimerOverflow(DupFrame[i].time)) DupFrame[i].time=0;  /* Clear old frame */      
-        if(DupFrame[i].time==0) continue;                        /* Skip if slot is empty */
-        if(DupFrame[i].crc==pkt_crc) flag=1;                     /* !! Find duplicate packet */
-    } 
 
-    return flag;
+/******************************************************************************
+* TestDup
+*
+* Return TRUE if packet fingerprint is already in duplicate table.
+******************************************************************************/
+int TestDup(uint16_t pkt_crc) {
+    uint8_t i, slot;
+
+    for(i=0; i<DUP_PROBE; i++) {
+        slot = (pkt_crc + i) & (DUP_MAXFRAME-1);
+        if(Keep.DupFrame[slot].crc == pkt_crc && DupAlive(slot)) return 1;    /* !! Find duplicate packet */
+    }
+    return 0;
 }
 
 
 /******************************************************************************
 * AddDupList
 *
-* Add packet to duplicate table. If table is full, oldest is deleted and
-* replaced by the new.
-*
-* Only Data field is keeped for comparaison. Only UI frame.
+* Add packet fingerprint to duplicate table. Use first free or expired slot,
+* else replace the one expiring first.
 ******************************************************************************/
-void AddDupList(unsigned char *p, int size) {
-    uint8_t i,old;
-    uint32_t oldest_time;
-    uint16_t pkt_crc=0xFFFF;
+void AddDupList(uint16_t pkt_crc) {
+    uint8_t i, slot, old;
+    int8_t remain, oldest = 127;
+
+    old = pkt_crc & (DUP_MAXFRAME-1);
+    for(i=0; i<DUP_PROBE; i++) {
+        slot = (pkt_crc + i) & (DUP_MAXFRAME-1);
+        if(!DupAlive(slot) || Keep.DupFrame[slot].crc == pkt_crc) { old = slot; break; }
+        remain = Keep.DupFrame[slot].time - (uint8_t)wdt_clk;
+        if(remain < oldest) { oldest = remain; old = slot; }
+    }
 
-    /* COMPUTE CRC*/
-    for(i=0; i<size; i++) pkt_crc = DoCRC(pkt_crc, p[i]);
+    /* 0 IS EMPTY SLOT */
+    Keep.DupFrame[old].crc = pkt_crc;
+    Keep.DupFrame[old].time = (uint8_t)(wdt_clk + Config[CFG_DUP]);
+    if(Keep.DupFrame[old].time == 0) Keep.DupFrame[old].time = 1;
+}
 
-    /* PLACE FRAME INTO FIRST EMPTY SLOT */
-    for(i=0; i<DUP_MAXFRAME; i++) {
-        if(DupFrame[i].time==0) {
-            DupFrame[i].time = wdt_clk + DUP_DELAY;
-            DupFrame[i].crc = pkt_crc;
-            return;
-        }
+
+/******************************************************************************
+ * uint8_t SrcRateAllow(unsigned char *call, uint8_t length)
+ * 
+ * Per source airtime token bucket, in ms of time on air at current modem 
+ * config. Bucket refill SRC_RATE_MS each SRC_RATE_PERIOD sec. Source not in 
+ * table start with SRC_RATE_NEW, in place of the one not seen since the 
+ * longest time among those having at least SRC_RATE_NEW (would come back 
+ * with same budget). Source in debt stay in table, when all are in debt new 
+ * source is not tracked.
+ * Return 0 if source has used its budget, frame must not be digipeated.
+ ******************************************************************************/
+#if SRC_RATE_MAX > 0
+uint16_t SrcRateTokens(struct TSrcRate *r) {
+    uint32_t tokens = r->tokens + (wdt_clk - r->time) * SRC_RATE_MS / SRC_RATE_PERIOD;
+
+    return tokens > SRC_RATE_MS ? SRC_RATE_MS : tokens;
+}
+
+uint8_t SrcRateAllow(unsigned char *call, uint8_t length) {
+    uint8_t i, old = SRC_RATE_MAX;
+    uint16_t cost = lora.timeOnAir(length);
+    struct TSrcRate *r;
+
+    /* FIND SOURCE OR OLDEST SLOT NOT IN DEBT */
+    for(i=0; i<SRC_RATE_MAX; i++) {
+        if(memcmp(SrcRate[i].call, call, 6) == 0 && SrcRate[i].call[6] == (call[6]&0x1E)) break;
+        if(SrcRate[i].call[0] != 0 && SrcRateTokens(&SrcRate[i]) < SRC_RATE_NEW) continue;
+        if(old == SRC_RATE_MAX || SrcRate[i].time < SrcRate[old].time) old = i;
     }
+    if(i == SRC_RATE_MAX) {
+        if(old == SRC_RATE_MAX) return 1;
+        r = &SrcRate[old];
+        memcpy(r->call, call, 6);
+        r->call[6] = call[6]&0x1E;
+        r->tokens = SRC_RATE_NEW;
+        r->throttled = 0;
+    } else {
 
-    /* LIST IS FULL, FIND OLDEST FRAME */
-    old = 0;
-    oldest_time = DupFrame[0].time;
-    for(i=1; i<DUP_MAXFRAME; i++) {
-        if( (long)(DupFrame[i].time-oldest_time)<0 ) {
-            old = i;
-            oldest_time = DupFrame[i].time;
-        }
+        /* REFILL SINCE LAST FRAME */
+        r = &SrcRate[i];
+        r->tokens = SrcRateTokens(r);
     }
+    r->time = wdt_clk;
 
-    /* REPLACE OLDEST FRAME BY NEW */
-    DupFrame[old].time = wdt_clk + DUP_DELAY;
-    DupFrame[old].crc = pkt_crc;
+    /* TAKE AIRTIME OF FRAME FROM BUCKET */
+    if(r->tokens < cost) {
+        if(r->throttled < 0xFFFF) r->throttled++;
+        Keep.stat_throttled++;
+        return 0;
+    }
+    r->tokens -= cost;
+    return 1;
 }
+#endif
 
 
 /******************************************************************************
 * DigiRepeat
 * 
-* Send digipeated packet and update stat
+* Queue digipeated packet, packet is the received frame in RX slot. Frame is
+* sent in same format as received, ASCII frame are edited in place. src is
+* source call (AX25 format) for airtime rate limit.
+* 
+* In viscous mode, frame is held VISCOUS_DELAY sec and only sent if no other
+* digi has repeated it in that time (see ViscousCancel).
 ******************************************************************************/
-void DigiRepeat(unsigned char *packet, int packet_size) {
-
-    /* REPLY IN SAME FORMAT AS RECEIVED. ASCII OR BINARY */
-    #if OE_TYPE_PACKET_ENABLE==1
-    if(pkt_oe_format == true) {
-		char *buf = (char*)malloc(256);
-		if(buf) {
-			buf[0] = '<'; 
-			buf[1] = 0xFF; 
-			buf[2] = 0x01; 			
-			DecodeAX25(packet, packet_size, &buf[3]);
-			WaitClearChannel();
-			lora.tx((uint8_t*)buf, strlen(&buf[3])+3);
-			while(lora.txBusy());
-			stat_digipeated_pkt++;
-			free(buf);
-			return;
-		}
-	}
-	#endif
+void DigiRepeat(unsigned char *packet, int packet_size, unsigned char *src, uint16_t fingerprint) {
 
-	/* WAIT CHANNEL CLEAR AND SEND BEACON */
-    WaitClearChannel();
-    lora.tx(packet, packet_size);
-    while(lora.txBusy());
-    stat_digipeated_pkt++;
+    if(RxFrame == 0 || packet != RxFrame->buf) return;
+
+    #if SRC_RATE_MAX > 0
+    if(!SrcRateAllow(src, packet_size)) return;
+    #endif
+
+    TxEnqueue(RxFrame, packet_size, TXQ_DIGI);
+    RxFrame->fp = fingerprint;
+    #if VISCOUS_DELAY > 0
+    RxFrame->hold += VISCOUS_DELAY;
+    RxFrame->deadline += VISCOUS_DELAY;
+    Keep.stat_visc_held++;
+    #endif
+}
+
+
+/******************************************************************************
+* ViscousCancel
+* 
+* Frame with fingerprint has been heard digipeated by another station, drop 
+* held copy.
+******************************************************************************/
+#if VISCOUS_DELAY > 0
+void ViscousCancel(uint16_t fingerprint) {
+    uint8_t i;
+
+    for(i=0; i<FRAME_POOL; i++) {
+        if(Frame[i].owner == FRAME_QUEUED && Frame[i].prio == TXQ_DIGI && Frame[i].fp == fingerprint && wdt_clk < Frame[i].hold) {
+            FrameFree(&Frame[i]);
+            Keep.stat_visc_cancel++;
+        }
+    }
+}
+#endif
+
+
+/******************************************************************************
+ * void HeardUpdate(unsigned char *call, uint8_t via, int16_t rssi, int8_t snr)
+ * 
+ * Add station to heard table with signal of received packet. Station not in 
+ * table replace the one not heard since the longest time. Signal is only 
+ * taken from direct copy, a digipeated one is signal of last digi.
+ ******************************************************************************/
+#if HEARD_MAX > 0
+void HeardUpdate(unsigned char *call, uint8_t via, int16_t rssi, int8_t snr) {
+    uint8_t i, old = 0;
+    struct THeard *h;
+
+    rssi = -rssi;
+    if(rssi > 255) rssi = 255;
+    if(rssi < 0) rssi = 0;
+
+    /* FIND STATION OR OLDEST SLOT */
+    for(i=0; i<HEARD_MAX; i++) {
+        if(memcmp(Heard[i].call, call, 6) == 0 && (Heard[i].call[6]&0x1E) == (call[6]&0x1E)) break;
+        if(Heard[i].time < Heard[old].time) old = i;
+    }
+    if(i == HEARD_MAX) {
+        h = &Heard[old];
+        memcpy(h->call, call, 7);
+        h->count = 0;
+        h->flag = 0;
+    } else h = &Heard[i];
+
+    h->time = wdt_clk;
+    if(h->count < 0xFFFF) h->count++;
+    if(via) {
+        h->flag |= HEARD_VIA;
+        return;
+    }
+
+    /* DIRECT, SIGNAL AVERAGE ON 4 PACKETS */
+    if(!(h->flag & HEARD_DIRECT)) {
+        h->rssi_avg = rssi;
+        h->snr_avg = snr;
+    }
+    h->direct = wdt_clk;
+    h->rssi = rssi;
+    h->snr = snr;
+    h->rssi_avg = (3 * (int16_t)h->rssi_avg + rssi + 2) / 4;
+    h->snr_avg = (3 * (int16_t)h->snr_avg + snr) / 4;
+    h->flag |= HEARD_DIRECT;
+}
+
+
+/******************************************************************************
+ * void HeardRxSave(uint8_t *call, uint8_t ascii, uint8_t *sig)
+ * void HeardRxService()
+ * 
+ * Path-less frame dropped by RX filter (in interrupt) is only a direct 
+ * station for heard table. Filter save source call and signal from header,
+ * DigiPoll add it. One entry, a second one before DigiPoll replace it.
+ ******************************************************************************/
+void HeardRxSave(uint8_t *call, uint8_t ascii, uint8_t *sig) {
+    uint8_t i;
+
+    for(i=0; i<(ascii ? 9 : 7) && !(ascii && call[i] == '>'); i++) HeardRx.call[i] = call[i];
+    HeardRx.call[i] = 0;
+    HeardRx.ascii = ascii;
+    HeardRx.snr = sig[0];
+    HeardRx.rssi = sig[1];
+    HeardRxPending = 1;
+}
+
+void HeardRxService() {
+    struct THeardRx rx;
+    unsigned char call[7];
+
+    if(!HeardRxPending) return;
+    noInterrupts();
+    memcpy(&rx, (const void*)&HeardRx, sizeof(rx));
+    HeardRxPending = 0;
+    interrupts();
+    if(rx.ascii) asc2AXcall(rx.call, call);
+    else memcpy(call, rx.call, 7);
+    HeardUpdate(call, 0, SX1278::rawRSSI(rx.rssi), SX1278::rawSNR(rx.snr));
 }
 
 
 /******************************************************************************
- * void MessageHandler(unsigned char *buf, size)
+ * void HeardReply(char *call)
  * 
+ * Reply to ?APRSD query with list of station heard direct, average signal.
+ * Message text is limited to 67 caracters.
  ******************************************************************************/
-void MessageHandler(unsigned char *buf, uint8_t size) {
+void HeardReply(char *call) {
+    uint8_t i, start;
+    char *s;
+
+    if(!CreatePacket()) return;
+    index += sprintf_P((char*)&pkt[index], PSTR(":%-9s:"), call);
+    start = index;
+    index += sprintf_P((char*)&pkt[index], PSTR("Directs="));
+    for(i=0; i<HEARD_MAX; i++) {
+        if(Heard[i].call[0] == 0 || !(Heard[i].flag & HEARD_DIRECT)) continue;
+        if(wdt_clk - Heard[i].direct > HEARD_TIMEOUT) continue;
+        s = AXCall2asc(Heard[i].call);
+        if(index - start + strlen(s) + 12 > 67) break;
+        index += sprintf_P((char*)&pkt[index], PSTR(" %s(-%u/%d)"), s, Heard[i].rssi_avg, Heard[i].snr_avg);
+    }
+    SendPacket(TXQ_QUERY);
+}
+#endif
+
+
+/******************************************************************************
+ * void ConfigMessage(char *text, char *call)
+ * 
+ * Remote config command, reply to call:
+ * CFG                   List parameter, N is last sequence accepted
+ * CFG XX                Read parameter XX
+ * CFG XX=value seq mac  Set parameter and save in EEPROM
+ * CFG DEF seq mac       Restore project.h default
+ * See ConfigAuth() for seq and mac.
+ *
+ * Command is done at once, reply is built by ConfigReplyService() from 
+ * DigiPoll() when a frame is free: message ack take the TX slot first (only
+ * one on ATmega168).
+ ******************************************************************************/
+#define CFGR_NONE  0
+#define CFGR_LIST  1
+#define CFGR_READ  2        // Value of ConfigReplyId
+#define CFGR_SET   3        // Value of ConfigReplyId and OK
+#define CFGR_DEF   4
+#define CFGR_ERR   5
+#define CFGR_AUTH  6
+
+char ConfigReplyCall[10];
+uint8_t ConfigReply, ConfigReplyId;
+
+void ConfigMessage(char *text, char *call) {
+    char *arg, *seq;
+    uint8_t id, auth;
+
+    auth = ConfigAuth(text);
+    strtok(text, " ");
+    arg = strtok(NULL, " ");
+    seq = strtok(NULL, " ");
+    strcpy(ConfigReplyCall, call);
+    id = arg ? ConfigFind(arg) : CFG_COUNT;
+    ConfigReplyId = id;
+
+    /* LIST OR READ ONE PARAMETER */
+    if(arg == 0) ConfigReply = CFGR_LIST;
+    else if(seq == 0) ConfigReply = (id < CFG_COUNT && arg[2] == 0) ? CFGR_READ : CFGR_ERR;
+
+    /* SET PARAMETER OR DEFAULT, AUTHENTICATED */
+    else if(!auth) ConfigReply = CFGR_AUTH;
+    else if(strcmp_P(arg, PSTR("DEF")) == 0) {
+        ConfigDefault();
+        ConfigReply = CFGR_DEF;
+    } else if(id < CFG_COUNT && arg[2] == '=' && ConfigSet(id, strtoul(&arg[3], 0, 10))) {
+        ConfigReply = CFGR_SET;
+    } else {
+        ConfigReply = CFGR_ERR;
+    }
+
+    /* SAVE, SEQUENCE IS USED EVEN IF VALUE IS REJECTED */
+    if(auth && seq) {
+        ConfigSave();
+        ChannelBackoff();
+        lora.setPower(Config[CFG_POWER]);
+    }
+}
+
+/* QUEUE PENDING REPLY, RETURN 1 IF QUEUED */
+uint8_t ConfigReplyService() {
+    uint8_t id, start;
+
+    if(ConfigReply == CFGR_NONE || !CreatePacket()) return 0;
+    index += sprintf_P((char*)&pkt[index], PSTR(":%-9s:"), ConfigReplyCall);
+    start = index;
+    index += sprintf_P((char*)&pkt[index], PSTR("CFG"));
+
+    /* LIST, TRUNCATED TO 67 CARACTERS */
+    if(ConfigReply == CFGR_LIST) {
+        index += sprintf_P((char*)&pkt[index], PSTR(" N=%lu"), (unsigned long)ConfigSeq());
+        for(id=0; id<CFG_COUNT && index - start + 9 <= 67; id++) {
+            pkt[index++] = ' ';
+            index += ConfigPrint((char*)&pkt[index], id);
+        }
+    } else if(ConfigReply == CFGR_READ || ConfigReply == CFGR_SET) {
+        pkt[index++] = ' ';
+        index += ConfigPrint((char*)&pkt[index], ConfigReplyId);
+        if(ConfigReply == CFGR_SET) index += sprintf_P((char*)&pkt[index], PSTR(" OK"));
+    } else if(ConfigReply == CFGR_DEF) {
+        index += sprintf_P((char*)&pkt[index], PSTR(" DEF OK"));
+    } else {
+        index += sprintf_P((char*)&pkt[index], (ConfigReply == CFGR_AUTH) ? PSTR(" ERR AUTH") : PSTR(" ERR"));
+    }
+    ConfigReply = CFGR_NONE;
+    SendPacket(TXQ_QUERY);
+    return 1;
+}
+
+
+/******************************************************************************
+ * void MessageHandler(unsigned char *buf, size, char *call)
+ * 
+ * Process message for this station, call is source callsign.
+ ******************************************************************************/
+void MessageHandler(unsigned char *buf, uint8_t size, char *call) {
 	
 	/* QUERY STATUS */
 	if(memcmp_P(buf, PSTR("?APRSS"), 6) == 0) {
-		Beacon3Timer=wdt_clk;
+		BeaconQueryTrigger(BCN_STATUS);
+		return;
+	}
+
+	/* QUERY DIRECT HEARD STATION */
+	#if HEARD_MAX > 0
+	if(memcmp_P(buf, PSTR("?APRSD"), 6) == 0) {
+		HeardReply(call);
 		return;
 	}
+	#endif
+
+	/* REMOTE CONFIG, TEXT WITHOUT ACK TAG */
+	if(size >= 3 && memcmp_P(buf, PSTR("CFG"), 3) == 0 && (size == 3 || buf[3] == ' ' || buf[3] == '{')) {
+		char text[68];
+		uint8_t i;
+		for(i=0; i<size && i<sizeof(text)-1 && buf[i] != '{'; i++) text[i] = buf[i];
+		text[i] = 0;
+		ConfigMessage(text, call);
+	}
 }
 
 
 /******************************************************************************
- * void DigiRules(unsigned char *packet, int packet_size)
+ * uint8_t FrameParse(unsigned char *packet, uint8_t length, struct TFrameView *v)
  * 
- * Apply digipeater rule to packet and digipeat if needed.ex
- *
- * Buffer Format:
- * Destination call : 6 byte + 1 bytes (CALL + SSID) SSID bit 4:1
- * Source call      : 6 byte + 1 bytes (CALL + SSID)
- * Path             : 6 byte + 1 bytes (CALL + SSID)   
- *                    ... up to 7 digipeting path, end with bit 0 of SSID set
- * Control          : 1 byte (must be UI frame)
- * PID              : 1 byte (don't care)                                              
- * Data frame       : variable
+ * Parse frame header in one pass and fill descriptor. Return 0 if frame is
+ * not valid:
+ * -Too short frame or header going past end of frame
+ * -AX25: address final bit not call field aligned, non-UI frame
+ * -ASCII: no '>' or ':' in header
+ * -More than VIEW_MAXHOP path entry
+ ******************************************************************************/
+uint8_t FrameParse(unsigned char *packet, uint8_t length, struct TFrameView *v) {
+    uint8_t i;
+
+    /* REMOVE TOO SHORT PACKET 7+7(SRC/DEST) + 2(UI/PID) + 1(DATA) */
+    if(length<17) return 0;
+    v->hops = 0;
+    v->unused = 0;
+    v->mark = 0;
+
+    /* ASCII HEADER: < 0xFF 0x01 SRC>DEST,PATH1,PATH2*:DATA */
+	#if OE_TYPE_PACKET_ENABLE==1
+    v->ascii = (packet[0] == '<' && packet[1] == 0xFF);
+    if(v->ascii) {
+        for(i=3; i<length && packet[i]!='>'; i++);
+        for(v->dest_end=0; i<length && packet[i]!=':'; i++) {
+            if(packet[i] == ',') {
+                if(v->dest_end == 0) v->dest_end = i;
+                if(v->hops == VIEW_MAXHOP) return 0;
+                v->hop[v->hops++] = i+1;
+            } else if(packet[i] == '*') {
+                v->mark = i;
+                v->unused = v->hops;
+            }
+        }
+        if(i >= length) return 0;
+        if(v->dest_end == 0) v->dest_end = i;
+        v->data = i+1;
+        v->data_len = length - v->data;
+        asc2AXcall((char*)&packet[3], v->src);
+        return 1;
+    }
+	#else
+    v->ascii = 0;
+	#endif
+
+    /* AX25 ADDRESS, PATH START AFTER SOURCE, H BIT SET ON USED PATH */
+    for(i=6; i<length && (packet[i]&1)==0; i+=7) {
+        if(i < 13) continue;
+        if(v->hops == VIEW_MAXHOP) return 0;
+        v->hop[v->hops] = i+1;
+        if(i+7 < length && (packet[i+7]&0x80)) v->unused = v->hops+1;
+        v->hops++;
+    }
+    if(i==6 || i+3 > length) return 0;        // Final bit too early or past end of frame
+    if(packet[i+1]!=0x03) return 0;           // Not UI frame
+    v->data = i+3;                            // Skip UI and PID
+    v->data_len = length - v->data;
+    memcpy(v->src, &packet[7], 7);
+    return 1;
+}
+
+
+/******************************************************************************
+ * uint8_t DigiDataRules(unsigned char *packet, struct TFrameView *v,
+ *                       uint16_t *fingerprint)
  * 
+ * Rules common to AX25 and ASCII frame, on source call and data field. 
+ * Return 0 if frame must not be digipeated, else fingerprint is set for 
+ * duplicate list.
+ *
  * Rule:
- * -Reject any non-UI frame
  * -Reject packet from this node (Source call = Node call)
+ * -Test if packet is in duplicate list, cancel held copy if repeated by other
+ * -Process message for this node, and ack them
  * -Trig beacon 1 if data frame contain ?APRS?
- * -Trig beacon 3 if data frame contain :<nodecall>:?APRSS
- * -Test if packet is in duplicate list
- * -Process generic SSID digipeating
- * -Reject if no path
- * -Test for WIDEn-n
  ******************************************************************************/
-void DigiRules(unsigned char *packet, uint8_t packet_size) {
-    uint8_t DataIndex,PathIndex,i;  
-    unsigned char flag,ssid,c; 
-    unsigned char NodeCall[7];
-    char tmp[12]; 
-    
-    /* REJECT NON-UI FRAME, FIND DATA FRAME (DataIndex) */
-    for(DataIndex=0; DataIndex<packet_size; DataIndex++) if(packet[DataIndex]&1) break;
-    if(packet[++DataIndex]!=0x03) return;   
-    DataIndex+=2;   /* Skip PID */
-    
+uint8_t DigiDataRules(unsigned char *packet, struct TFrameView *v, uint16_t *fingerprint) {
+    uint8_t i, flag;
+    unsigned char *src = v->src;
+    unsigned char *data = &packet[v->data];
+    uint8_t size = v->data_len;
+
     /* TEST FOR PACKET FROM THIS NODE */
-	asc2AXcall(MYCALL, NodeCall);
-    for(i=0, flag=0; i<7; i++) { 
-        if(i!=6) {
-            if(packet[7+i]!=NodeCall[i]) { flag=1; break; }   
-        } else {
-            if((packet[7+i]&0x1E)!=(NodeCall[i]&0x1E)) { flag=1; break; }   
-        }
+    if(memcmp(src, NodeCall, 6) == 0 && (src[6]&0x1E) == (NodeCall[6]&0x1E)) return 0;
+
+    /* TEST FOR DUPLICATE PACKET, REPEATED BY A DIGI IF ANY PATH IS USED */
+    *fingerprint = Fingerprint(src, data, size);
+    if(TestDup(*fingerprint)) {
+        #if VISCOUS_DELAY > 0
+        if(v->unused) ViscousCancel(*fingerprint);
+        #endif
+        return 0; 
     }
-    if(flag==0) return; 
-
-    /* TEST FOR DUPLICATE PACKET */
-    if(TestDup(&packet[DataIndex], packet_size-DataIndex)) return; 
 
 	/* CHECK MESSAGE FOR THIS STATION */
-	sprintf(tmp, ":%-9s:", MYCALL);
-	if(memcmp(&packet[DataIndex], tmp, 11) == 0) {
+	if(size >= 11 && memcmp(data, MsgHeader, 11) == 0) {
 
-		/* PROCESS MSG */
-		MessageHandler(&packet[DataIndex+11], packet_size-11-DataIndex);
-		
-		/* REPLY */
-		for(uint8_t i=DataIndex; i<packet_size; i++) {
-			if(packet[i]=='{') {			// Scan for ACK number
-						
-				/* GET TAG */
-				int tag=0;
+		/* GET ACK TAG AND SOURCE CALLSIGN */
+		int tag=-1;
+		for(i=0; i<size; i++) {
+			if(data[i]=='{') {			// Scan for ACK number
+				tag=0;
 				i++;   
-				while(isdigit(packet[i]) && i<packet_size) {    
+				while(i<size && isdigit(data[i])) {    
 					tag*=10; 
-					tag+=(packet[i++]-48);   
+					tag+=(data[i++]-48);   
 				}
+				break;
+			}
+		}
+		char call[10];
+		strcpy(call, AXCall2asc(src));
 
-				/* GET SOURCE CALLSIGN */
-				char *call = AXCall2asc(&packet[7]);
-			
-				/* CREATE PACKET */
-				CreatePacket();
-				index += sprintf((char*)pkt+index,":%-9s:ack%u",call,tag);
-                SendPacket();            		
-				return;
-			}	    
+		/* PROCESS MSG */
+		MessageHandler(&data[11], size-11, call);
+		
+		/* REPLY ACK */
+		if(tag >= 0) {
+			if(CreatePacket()) {
+				index += sprintf_P((char*)pkt+index, PSTR(":%-9s:ack%u"),call,tag);
+				SendPacket(TXQ_ACK);            		
+			}
 		}
-		return;
+		return 0;
 	}
 	
     /* TEST FOR ?APRS? QUERY */
-    for(i=0, flag=0; i<6; i++) if(packet[i+DataIndex]!="?APRS?"[i]) { flag=1; break; }
-    if(flag==0) Beacon1Timer=wdt_clk; 
+    for(i=0, flag=0; i<6 && i<size; i++) if(data[i]!="?APRS?"[i]) { flag=1; break; }
+    if(flag==0 && i==6) {
+        BeaconQueryTrigger(BCN_POS1);
+    }
+
+    return 1;
+}
+
+
+/******************************************************************************
+ * uint8_t AliasMatch(char *call, uint8_t ssid, uint8_t preempt, uint8_t *n)
+ * 
+ * Search path alias rule for one path entry, call is text without SSID. 
+ * Only rule with RULE_PREEMPT are checked if preempt is set. Return action 
+ * (ACT_xxx), 0 if no rule match. New N is set in *n.
+ ******************************************************************************/
+uint8_t AliasMatch(char *call, uint8_t ssid, uint8_t preempt, uint8_t *n) {
+    uint8_t i, flag, max, len;
+    char alias[7], tmp[10];
+
+    for(i=0; i<sizeof(AliasRule)/sizeof(AliasRule[0]); i++) {
+        flag = pgm_read_byte(&AliasRule[i].flag);
+        max = pgm_read_byte(&AliasRule[i].max);
+        if(flag & RULE_CFGMAX) max = Config[CFG_WIDEN];
+        if(preempt && !(flag & RULE_PREEMPT)) continue;
+        strcpy_P(alias, AliasRule[i].alias);
+        len = strlen(alias);
+
+        if(flag & RULE_MYCALL) {
+            sprintf_P(tmp, ssid ? PSTR("%s-%u") : PSTR("%s"), call, ssid);
+            if(strcmp(tmp, MYCALL) != 0) continue;
+            ssid = 0;
+        } else if(flag & RULE_NN) {
+            if(strncmp(call, alias, len) != 0 || (uint8_t)strlen(call) != len+1) continue;
+            if(call[len]<'1' || call[len]>('0'+max)) continue;   // n between 1 and maximum
+            if(ssid==0 || ssid>max) continue;                      // N between 1 and maximum
+            ssid--;
+        } else {
+            if(strcmp(call, alias) != 0 || ssid != max) continue;
+            ssid = 0;
+        }
+
+        /* N STAY OVER 0, OR N REACH 0 / FIXED ALIAS */
+        *n = ssid;
+        if(ssid) return ACT_DECR | ((flag & RULE_INSERT) ? ACT_INSERT : 0);
+        if(flag & RULE_SUBST) return ACT_SUBST;
+        return ((flag & RULE_NN) ? ACT_DECR : 0) | ACT_MARK | ((flag & RULE_INSERT) ? ACT_INSERT : 0);
+    }
+    return 0;
+}
+
+
+/******************************************************************************
+ * uint8_t AliasFind(unsigned char *packet, struct TFrameView *v, uint8_t *k,
+ *                   uint8_t *n)
+ * 
+ * Apply rule matcher on first unused path entry, then further down path with
+ * preemptive rules. Entry index is set in *k. Return action, 0 if no match.
+ ******************************************************************************/
+uint8_t AliasFind(unsigned char *packet, struct TFrameView *v, uint8_t *k, uint8_t *n) {
+    uint8_t i, j, ssid, act;
+    char call[7];
+    unsigned char *p;
+
+    for(j=v->unused; j<v->hops; j++) {
+        p = &packet[v->hop[j]];
+
+        /* PATH ENTRY TO TEXT CALL AND SSID */
+        #if OE_TYPE_PACKET_ENABLE==1
+        if(v->ascii) {
+            for(i=0; i<6 && isalnum(p[i]); i++) call[i] = p[i];
+            call[i] = 0;
+            ssid = (p[i] == '-') ? atoi((char*)&p[i+1]) : 0;
+            if(p[i] == '-') i += (ssid > 9) ? 3 : 2;
+            if(p[i] != ',' && p[i] != ':') continue;     // Bad or too long call
+        } else
+        #endif
+        {
+            for(i=0; i<6 && p[i] != (' '<<1); i++) call[i] = p[i]>>1;
+            call[i] = 0;
+            ssid = (p[6]&0x1E)>>1;
+        }
+
+        act = AliasMatch(call, ssid, j != v->unused, n);
+        if(act) {
+            *k = j;
+            return act;
+        }
+    }
+    return 0;
+}
+
+
+/******************************************************************************
+ * void DigiRules(unsigned char *packet, uint8_t packet_size, struct TFrameView *v)
+ * 
+ * Apply digipeater rule to AX25 packet and digipeat if needed.
+ *
+ * Buffer Format:
+ * Destination call : 6 byte + 1 bytes (CALL + SSID) SSID bit 4:1
+ * Source call      : 6 byte + 1 bytes (CALL + SSID)
+ * Path             : 6 byte + 1 bytes (CALL + SSID)   
+ *                    ... up to 8 digipeting path, end with bit 0 of SSID set
+ * Control          : 1 byte (must be UI frame)
+ * PID              : 1 byte (don't care)                                              
+ * Data frame       : variable
+ * 
+ * Rule:
+ * -Data field rules, see DigiDataRules()
+ * -Process generic SSID digipeating
+ * -Reject if no path
+ * -Path alias rules, see AliasRule[]
+ * -Reject if our call must be inserted in full path (8 entry)
+ ******************************************************************************/
+void DigiRules(unsigned char *packet, uint8_t packet_size, struct TFrameView *v) {
+    uint8_t PathIndex,i,k,n,act;  
+    uint16_t fingerprint;
+    unsigned char ssid; 
+    
+    /* OWN PACKET, DUPLICATE, MESSAGE AND QUERY */
+    if(!DigiDataRules(packet, v, &fingerprint)) return;
+
+    /* INSERT POSITION IS AFTER LAST USED PATH */
+    PathIndex = 14 + 7*v->unused;
   
     /* TEST FOR DEST SSID DIGIPEATING */ 
     ssid = (packet[6]&0x1E)>>1;
-    if(ssid!=0 && ssid<=WIDEN_MAX) {
+    if(ssid!=0 && ssid<=Config[CFG_WIDEN]) {
+
+        /* NO ROOM FOR DIGICALL, PATH IS FULL */
+        if(v->hops == VIEW_MAXHOP) return;
 		
 		/* DECREMENT DEST SSID AND ADD TO DUP LIST */
         packet[6] = (packet[6]&0xE1) | ((ssid-1)<<1);   // Decrement SSID
-        AddDupList(&packet[DataIndex],packet_size-DataIndex);
+        AddDupList(fingerprint);
         
-        /* SEARCH WHERE TO INSERT DIGI CALL */
-        PathIndex = 14;
-		while((packet[PathIndex-1]&1)==0 && (packet[PathIndex+6]&128)!=0) PathIndex+=7;    
-
         /* MAKE ROOM FOR DIGICALL */
-		for(i=(packet_size-1); i>=PathIndex; i--) packet[i+7] = packet[i];
+        if(packet_size > FRAME_SIZE-7) return;
+        memmove(&packet[PathIndex+7], &packet[PathIndex], packet_size-PathIndex);
 
         /* COPY DIGI CALL TO PATH */
         memcpy(&packet[PathIndex], NodeCall, sizeof(NodeCall));
@@ -421,139 +1578,343 @@ void DigiRules(unsigned char *packet, uint8_t packet_size) {
         packet_size+=7;
         
         /* DIGIPEAT THEM */
-        DigiRepeat(packet, packet_size);  
+        DigiRepeat(packet, packet_size, v->src, fingerprint);  
         return;
     }
 
-    /* REJECT PACKET IF NO PATH */
-    if(packet[13]&1) return;
-
-    /* TEST PATH FOR WIDEn-n */
-    PathIndex = 14;
-    while(1) {     
-        if( (packet[PathIndex+6]&0x80) == 0) { 
-                    
-            /* GET SSID */
-            ssid = (packet[PathIndex+6]&0x1E)>>1; 
-            flag=0;
-            for(i=0; i<4; i++) { if(packet[PathIndex+i]!=("WIDE"[i])<<1) flag=1; } /* Call must be WIDE */
-            if(ssid==0 || ssid>WIDEN_MAX) flag=1;  /* ssid must be 1 to wide-n maximum */
-            c = packet[PathIndex+4]>>1;
-            if(c<'1' || c>('0'+WIDEN_MAX)) flag=1;  /* Test WIDEn : n must be between 1 and maximum */
-
-            if(flag==0) {
-                ssid--;                         /* decrement SSID */
-                packet[PathIndex+6] = (packet[PathIndex+6]&0xE1) | (ssid<<1);   
- 
-                /* MAKE ROOM FOR DIGICALL IF SSID IS NOT 0 */
-                if(ssid) {
-                    for(i=(packet_size-1); i>=PathIndex; i--) packet[i+7] = packet[i];
-                    packet[PathIndex+6] = 0; // Clear end of path bit
-                    DataIndex+=7;
-                    packet_size+=7;
-                }
-
-                /* COPY DIGI CALL TO PATH  */
-                for(i=0; i<6; i++) packet[PathIndex+i] = NodeCall[i];
-                packet[PathIndex+6] = (packet[PathIndex+6]&0xE1) | (NodeCall[6]&0x1E);
-                packet[PathIndex+6] |= 0x80;     /* Set has-been-repeated bit */   
-
-                /* DIGIPEAT IT */
-                AddDupList(&packet[DataIndex],packet_size-DataIndex);
-                DigiRepeat(packet, packet_size);
-                return;  
-            }                                                               
-            return;   // If no rules apply to current digi path, exit now.
-        }
-    
-        if(packet[PathIndex+6]&1) break;       // Stop at end of path 
-        PathIndex+=7;
-    } 
+    /* REJECT PACKET IF NO PATH OR NO ALIAS RULE MATCH */
+    if(v->unused == v->hops) return;
+    if((act = AliasFind(packet, v, &k, &n)) == 0) return;
+    if((act & ACT_INSERT) && v->hops - (k - v->unused) == VIEW_MAXHOP) return;
+
+    /* PREEMPTIVE, REMOVE UNUSED PATH BEFORE MATCHED ONE */
+    if(k > v->unused) {
+        memmove(&packet[PathIndex], &packet[14+7*k], packet_size-14-7*k);
+        packet_size -= 7*(k-v->unused);
+    }
+
+    /* NEW N, MARK AS USED OR REPLACE BY OUR CALL */
+    if(act & ACT_DECR) packet[PathIndex+6] = (packet[PathIndex+6]&0xE1) | (n<<1);
+    if(act & ACT_MARK) packet[PathIndex+6] |= 0x80;
+    if(act & ACT_SUBST) {
+        for(i=0; i<6; i++) packet[PathIndex+i] = NodeCall[i];
+        packet[PathIndex+6] = (packet[PathIndex+6]&0xE1) | (NodeCall[6]&0x1E) | 0x80;
+    }
+
+    /* MAKE ROOM AND INSERT OUR CALL BEFORE ALIAS */
+    if(act & ACT_INSERT) {
+        if(packet_size > FRAME_SIZE-7) return;
+        memmove(&packet[PathIndex+7], &packet[PathIndex], packet_size-PathIndex);
+        memcpy(&packet[PathIndex], NodeCall, 6);
+        packet[PathIndex+6] = (NodeCall[6]&0x7E) | 0x80;  /* Set has-been-repeated bit, no end of path */
+        packet_size+=7;
+    }
+
+    /* DIGIPEAT IT */
+    AddDupList(fingerprint);
+    DigiRepeat(packet, packet_size, v->src, fingerprint);
 }
 
 
 /******************************************************************************
- * void DigiPoll()
- *
- * Check if beacon are timeout, transmit.
- *****************************************************************************/
-int DigiPoll() {
-    static uint8_t status, length, i, c;
-    static char *payload;
-    //TAX25Frame *ax25_frame;
-    
-    status = lora.rxAvailable(pkt, &length);
-    if(status==ERR_NONE) {
+ * uint8_t OeSplice(unsigned char *packet, uint8_t size, uint8_t pos, 
+ *                  uint8_t del, const char *ins)
+ * 
+ * Replace del caracters at pos by string ins. Return new size, or 0 if 
+ * frame would be too long.
+ ******************************************************************************/
+#if OE_TYPE_PACKET_ENABLE==1
+uint8_t OeSplice(unsigned char *packet, uint8_t size, uint8_t pos, uint8_t del, const char *ins) {
+    uint8_t n = strlen(ins);
+
+    if((uint16_t)size - del + n > FRAME_SIZE) return 0;
+    memmove(&packet[pos+n], &packet[pos+del], size-pos-del);
+    memcpy(&packet[pos], ins, n);
+    return size - del + n;
+}
 
-        /* REMOVE TOO SHORT PACKET 7+7(SRC/DEST) + 2(UI/PID) + 1(DATA) */
-        if(length<17) return 1;
 
-        /* IF PACKET ARE ASCII, CONVERT THEM BEFORE HEADER IS: < 0xFF 0x01 */
-	#if OE_TYPE_PACKET_ENABLE==1
-	pkt_oe_format = false;
-        if(pkt[0] == '<' && pkt[1] == 0xFF) {
-	    payload = (char*)malloc(255);
-            if(payload==0) return 0;
-            memset(payload, 0, 255);
-            memcpy(payload, &pkt[3], length-3);
-            length = EncodeAX25(payload, pkt);
-            free(payload);
-            pkt_oe_format = true;
-            stat_oe_pkt++;
-        } else {
-            stat_bin_pkt++;
-	}
-	#endif
+/******************************************************************************
+ * void DigiRulesOE(unsigned char *packet, uint8_t packet_size, struct TFrameView *v)
+ * 
+ * Apply digipeater rule to ASCII packet (OE style) and digipeat if needed.
+ * Header is edited in place, no AX25 conversion.
+ *
+ * Buffer Format:
+ *   < 0xFF 0x01 SRC>DEST,PATH1,PATH2*,PATH3:DATA
+ * 
+ * Last used path is marked with '*'. Path are edited from the end of header
+ * to the beginning, so offset found at parsing stay valid.
+ *
+ * Rule: same as DigiRules()
+ ******************************************************************************/
+void DigiRulesOE(unsigned char *packet, uint8_t packet_size, struct TFrameView *v) {
+    char *h = (char*)packet;
+    uint8_t dst_end = v->dest_end, star = v->mark, pos, end, ssid, k, n, act;
+    uint16_t fingerprint;
+    char digi[12];
 
-        /* SPOT CHECK FOR BAD PACKET, CHECK ADDRES FINAL BIT */
-        for(i=0; i<length; i++) { c=pkt[i]; if((c & 1) == 1) break; }  // Search for path final bit
-        if((c&1) == 0) return 1;                                       // Abort if no final bit
-        if(((i+1)%7) != 0) return 1;                                   // Abort if final bit position not call field aligned
-        if(i==6) return 1;                                             // Abort if final bit are too early on header
-              
-        /* DIGIPEAT AX25 PACKET */
-        stat_rx_pkt++;
-        DigiRules(pkt, length);
-        return 1;
+    /* OWN PACKET, DUPLICATE, MESSAGE AND QUERY */
+    if(!DigiDataRules(packet, v, &fingerprint)) return;
+
+    /* TEST FOR DEST SSID DIGIPEATING */ 
+    ssid = (h[dst_end-2]=='-' && isdigit(h[dst_end-1])) ? h[dst_end-1]-'0' : 0;
+    if(ssid!=0 && ssid<=Config[CFG_WIDEN]) {
+
+        /* INSERT DIGI CALL AFTER LAST USED PATH (IF PATH NOT FULL), MOVE '*' MARKER */
+        if(v->hops == VIEW_MAXHOP) return;
+        sprintf_P(digi, PSTR(",%s*"), MYCALL);
+        pos = star ? star+1 : dst_end;
+        if((packet_size = OeSplice(packet, packet_size, pos, 0, digi)) == 0) return;
+        if(star) packet_size = OeSplice(packet, packet_size, star, 1, "");
+
+        /* DECREMENT DEST SSID, REMOVE IT WHEN 0 */
+        if(ssid == 1) packet_size = OeSplice(packet, packet_size, dst_end-2, 2, "");
+        else h[dst_end-1]--;
+
+        AddDupList(fingerprint);
+        DigiRepeat(packet, packet_size, v->src, fingerprint);
+        return;
     }
 
-    /* BEACON 1 TIMEOUT */
-    if(TimerOverflow(Beacon1Timer)) 
-    { 
-        DigiSendBeacon(0);
-        Beacon1Timer = wdt_clk + (uint32_t)B1_INTERVAL;
-        return 1;
+    /* REJECT PACKET IF NO PATH, NO ALIAS RULE MATCH OR NO ROOM FOR OUR CALL */
+    if(v->unused == v->hops) return;
+    if((act = AliasFind(packet, v, &k, &n)) == 0) return;
+    if(packet_size > FRAME_SIZE-sizeof(digi)) return;
+    if((act & ACT_INSERT) && v->hops - (k - v->unused) == VIEW_MAXHOP) return;
+    pos = v->hop[k];
+    end = (k+1 < v->hops) ? v->hop[k+1]-1 : v->data-1;
+
+    /* NEW N (REMOVE SSID AT 0), MARK AS USED OR REPLACE BY OUR CALL */
+    if(act & ACT_MARK) packet_size = OeSplice(packet, packet_size, end, 0, "*");
+    if(act & ACT_DECR) {
+        if(n) h[end-1] = '0'+n;
+        else packet_size = OeSplice(packet, packet_size, end-2, 2, "");
+    }
+    if(act & ACT_SUBST) {
+        sprintf_P(digi, PSTR("%s*"), MYCALL);
+        packet_size = OeSplice(packet, packet_size, pos, end-pos, digi);
     }
 
-    /* BEACON 2 TIMEOUT */
-    if(TimerOverflow(Beacon2Timer)) 
-    {
-        DigiSendBeacon(1);
-        Beacon2Timer = wdt_clk + (uint32_t)B2_INTERVAL;
-        return 1;
+    /* INSERT OUR CALL BEFORE ALIAS */
+    if(act & ACT_INSERT) {
+        sprintf_P(digi, (act & ACT_MARK) ? PSTR("%s,") : PSTR("%s*,"), MYCALL);
+        packet_size = OeSplice(packet, packet_size, pos, 0, digi);
     }
 
-    /* BEACON 3 TIMEOUT */
-    if(TimerOverflow(Beacon3Timer)) 
-    {
-        DigiSendBeacon(2);
-        Beacon3Timer = wdt_clk + (uint32_t)B3_INTERVAL;
-        return 1;
+    /* PREEMPTIVE, REMOVE UNUSED PATH BEFORE MATCHED ONE, THEN OLD '*' MARKER */
+    if(k > v->unused) packet_size = OeSplice(packet, packet_size, v->hop[v->unused], pos-v->hop[v->unused], "");
+    if(star && (act & (ACT_MARK | ACT_SUBST | ACT_INSERT))) packet_size = OeSplice(packet, packet_size, star, 1, "");
+
+    /* DIGIPEAT IT */
+    AddDupList(fingerprint);
+    DigiRepeat(packet, packet_size, v->src, fingerprint);
+}
+#endif
+
+
+/******************************************************************************
+ * uint8_t DigiRxFilter(uint8_t *head, uint8_t size, uint8_t length)
+ *
+ * Called from DIO0 interrupt with the first bytes of frame, rest of payload 
+ * is still in radio FIFO. Airtime is added to channel load. Return 0 to drop 
+ * frame without reading it:
+ * -Too short frame
+ * -Frame from this node (our own echo)
+ * -Non-UI frame or bad address field
+ * -No path, no SSID digipeating and data is not a query or a message (source
+ *  call and signal are saved for heard list, see HeardRxSave)
+ *
+ * head[size] and head[size+1] are raw SNR and RSSI of the frame.
+ *
+ * Keep frame when header is longer than what was read.
+ *****************************************************************************/
+uint8_t DigiRxFilter(uint8_t *head, uint8_t size, uint8_t length) {
+    uint8_t i, ssid;
+
+    /* CHANNEL LOAD, ANY FRAME RECEIVED */
+    #if CHANNEL_ADAPTIVE==1
+    ChannelRxMs += lora.timeOnAir(length);
+    #endif
+
+    /* REMOVE TOO SHORT PACKET 7+7(SRC/DEST) + 2(UI/PID) + 1(DATA) */
+    if(length<17) return 0;
+
+    /* ASCII HEADER: < 0xFF 0x01 SRC>DEST,PATH:DATA */
+	#if OE_TYPE_PACKET_ENABLE==1
+    if(head[0] == '<' && head[1] == 0xFF) {
+        char *p = (char*)&head[3];
+        char *end = (char*)&head[size];
+        uint8_t n = strlen(MYCALL);
+
+        /* OWN ECHO */
+        if(size > 3+n && memcmp(p, MYCALL, n) == 0 && p[n] == '>') return 0;
+
+        /* FIND END OF DEST CALL, KEEP FRAME WITH A PATH */
+        while(p < end && *p != '>') p++;
+        while(p < end && *p != ',' && *p != ':') p++;
+        if(p >= end || *p == ',') return 1;
+        
+        /* NO PATH, CHECK DEST SSID AND FIRST DATA BYTE */
+        ssid = (p[-2] == '-' && isdigit(p[-1])) ? p[-1] - '0' : 0;
+        if(ssid != 0 && ssid <= Config[CFG_WIDEN]) return 1;
+        if(p+1 >= end) return 1;
+        if(p[1] == '?' || p[1] == ':') return 1;
+
+        /* DIRECT STATION, ONLY FOR HEARD LIST */
+        #if HEARD_MAX > 0
+        HeardRxSave(&head[3], 1, &head[size]);
+        #endif
+        return 0;
     }
+	#endif
 
-    /* TELEMETRY TIMEOUT */
-    #if VOLT_ENABLE==1 || BMP180_ENABLE==1 || DS_ENABLE==1
-    if(TimerOverflow(TelemTimer)) {
-        DigiSendTelem();
-        TelemTimer = wdt_clk + (uint32_t)TELEM_INTERVAL; 
-        return 1;
+    /* OWN ECHO, SOURCE CALL AND SSID ARE THIS NODE */
+    if(memcmp(&head[7], NodeCall, 6) == 0 && (head[13]&0x1E) == (NodeCall[6]&0x1E)) return 0;
+
+    /* FIND ADDRESS FINAL BIT, KEEP FRAME IF NOT IN HEADER */
+    for(i=0; i<size; i++) if(head[i]&1) break;
+    if(i >= size) return 1;
+    if(((i+1)%7) != 0 || i==6) return 0;         // Final bit not call field aligned
+    if(i+1 >= size) return 1;
+    if(head[i+1] != 0x03) return 0;              // Not UI frame
+
+    /* NO PATH, CHECK DEST SSID AND FIRST DATA BYTE */
+    if(i != 13) return 1;
+    ssid = (head[6]&0x1E)>>1;
+    if(ssid!=0 && ssid<=Config[CFG_WIDEN]) return 1;
+    if(i+3 >= size) return 1;
+    if(head[i+3] == '?' || head[i+3] == ':') return 1;
+
+    /* DIRECT STATION, ONLY FOR HEARD LIST */
+    #if HEARD_MAX > 0
+    HeardRxSave(&head[7], 0, &head[size]);
+    #endif
+    return 0;
+}
+
+
+/******************************************************************************
+ * void DigiReceive(unsigned char *packet, uint8_t length)
+ *
+ * Check received frame, update heard list and apply digipeater rules.
+ *****************************************************************************/
+void DigiReceive(unsigned char *packet, uint8_t length) {
+    struct TFrameView v;
+
+    /* PARSE HEADER ONCE, DROP BAD PACKET */
+    if(!FrameParse(packet, length, &v)) return;
+    Keep.stat_rx_pkt++;
+
+    /* ADD SOURCE TO HEARD LIST, VIA DIGI IF ANY PATH HAS BEEN REPEATED */
+    #if HEARD_MAX > 0
+    HeardUpdate(v.src, v.unused != 0, lora.getLastPacketRSSI(), lora.getLastPacketSNR());
+    #endif
+
+    /* ASCII PACKET ARE DIGIPEATED WITHOUT AX25 CONVERSION */
+	#if OE_TYPE_PACKET_ENABLE==1
+    if(v.ascii) {
+        Keep.stat_oe_pkt++;
+        DigiRulesOE(packet, length, &v);
+        return;
     }
+    Keep.stat_bin_pkt++;
 	#endif
-	
+
+    /* DIGIPEAT AX25 PACKET */
+    DigiRules(packet, length, &v);
+}
+
+
+/******************************************************************************
+ * void DigiPoll()
+ *
+ * Process one frame from radio RX queue, else send one frame from transmit
+ * queue, else check if beacon are timeout and queue them.
+ *****************************************************************************/
+int DigiPoll() {
+    static uint8_t status;
+    
+    /* DIRECT STATION DROPPED BY RX FILTER */
+    #if HEARD_MAX > 0
+    HeardRxService();
+    #endif
+
+    /* RECEIVE IN A FREE SLOT, RELEASED WHEN RULES ARE DONE IF NOT QUEUED FOR DIGIPEAT */
+    RxFrame = FrameAlloc(FRAME_RX);
+    if(RxFrame) {
+        status = lora.rxAvailable(RxFrame->buf, &RxFrame->len);
+        if(status==ERR_NONE) DigiReceive(RxFrame->buf, RxFrame->len);
+        if(RxFrame->owner == FRAME_RX) FrameFree(RxFrame);
+        RxFrame = 0;
+        if(status==ERR_NONE) return 1;
+    }
+
+    /* SINGLE TRANSMIT POINT, HIGHEST PRIORITY FRAME FIRST */
+    if(TxQueueService()) return 1;
+
+    /* CLEAR EXPIRED DUPLICATE */
+    DupSweep();
+
+    /* FOLLOW FREQUENCY DRIFT */
+    #if AFC_ENABLE==1
+    AfcUpdate();
+    #endif
+
+    /* PERSISTANCE FROM CHANNEL LOAD */
+    #if CHANNEL_ADAPTIVE==1
+    ChannelLoadUpdate();
+    #endif
+
+    /* REMOTE CONFIG REPLY, AFTER MESSAGE ACK */
+    if(ConfigReplyService()) return 1;
+
+    /* BEACON, TELEMETRY AND METADATA */
+    if(BeaconService()) return 1;
+
     return 0; 
 }
 
 
+/******************************************************************************
+ * void DigiFlush()
+ *
+ * Send all queued frame now (before radio sleep).
+ *****************************************************************************/
+void DigiFlush() {
+    while(TxQueueService());
+}
+
+
+/******************************************************************************
+ * uint32_t DigiNextEvent()
+ *
+ * Return wdt_clk value when DigiPoll() have something to do: beacon, queued 
+ * frame, duplicate sweep (if table not empty), AFC and channel load timer.
+ * Host test build HOST_TICK1 return now: watchdog stay at 1 s, as before
+ * tickless period, to compare wake-up count.
+ *****************************************************************************/
+uint32_t DigiNextEvent() {
+    uint32_t next = BCN_NEVER;
+    uint8_t i;
+
+    #ifdef HOST_TICK1
+    return wdt_clk;
+    #endif
+
+    for(i=0; i<DUP_MAXFRAME; i++) if(Keep.DupFrame[i].time) { next = DupSweepTimer; break; }
+    for(i=0; i<BCN_COUNT; i++) if(Keep.BeaconTime[i] < next) next = Keep.BeaconTime[i];
+    for(i=0; i<FRAME_POOL; i++) if(Frame[i].owner == FRAME_QUEUED && Frame[i].hold < next) next = Frame[i].hold;
+    #if AFC_ENABLE==1
+    if(AfcTimer < next) next = AfcTimer;
+    #endif
+    #if CHANNEL_ADAPTIVE==1
+    if(ChannelTimer < next) next = ChannelTimer;
+    #endif
+    return next + 1;                // Timer expire when wdt_clk is over value
+}
+
+
 /******************************************************************************
  * void DigiSleep()
  *
@@ -565,31 +1926,146 @@ void DigiSleep() {
 
 
 /******************************************************************************
- * void DigiWake()
+ * int DigiRadioInit()
  *
- * Wake-up Lora module and re-configure it.
+ * Reset Lora module and configure it.
  * 
  * Return 1 on success, else 0.
  *****************************************************************************/
-int DigiWake() {
+int DigiRadioInit() {
     if(lora.begin(LORA_CS, LORA_RESET, LORA_DIO) == ERR_CHIP_NOT_FOUND) return 0;   
-    lora.setFrequency((FREQ * 1000000.0)+FREQ_ERR);   // APRS freq
-    lora.setPpmError(PPM_ERR);
-    lora.setPower(LORA_POWER);  // dbm (max 20)
+    lora.setFrequency((FREQ * 1000000.0)+FREQ_ERR+Keep.AfcOffset);   // APRS freq
+    lora.setPpmError(lround(0.95 * ((FREQ_ERR + Keep.AfcOffset) / FREQ)));
+    lora.setPower(Config[CFG_POWER]);  // dbm (max 20)
     delay(50);
     return 1;
 }
 
 
+/******************************************************************************
+ * void DigiWake()
+ *
+ * Wake-up Lora module after DigiSleep(). Register are keeped in sleep mode,
+ * full reset and configure only if they are lost. Duplicate table is cleared.
+ * 
+ * Return 1 on success, else 0.
+ *****************************************************************************/
+int DigiWake() {
+
+    /* SLEEP IS LONGER THAN DUP_DELAY, ALL EXPIRED (8 BITS TIME WOULD WRAP) */
+    memset(Keep.DupFrame, 0, sizeof(Keep.DupFrame));
+    if(lora.resume() == ERR_NONE) return 1;
+    return DigiRadioInit();
+}
+
+
+/******************************************************************************
+ * Kept state across watchdog reset
+ *
+ * DigiSeal() is called by watchdog IRQ just before reset, cause is 'D' for 
+ * daily reboot or 'H' for hang. KeepRestore() add reset cause to log, check 
+ * kept state and rebase timer on new wdt_clk. Return 0 (and clear state) if
+ * not valid, or if reset was a hang: only stat and AFC are restored then, 
+ * duplicate and beacon schedule start over.
+ *****************************************************************************/
+uint16_t KeepCRC(void *p, uint8_t n) {
+    uint16_t crc = 0xFFFF;
+
+    for(uint8_t i=0; i<n; i++) crc = DoCRC(crc, ((uint8_t*)p)[i]);
+    return crc;
+}
+
+void DigiSeal(char cause) {
+    Keep.clk = wdt_clk;
+    Keep.cause = cause;
+    Keep.magic = KEEP_MAGIC;
+    Keep.crc = KeepCRC(&Keep, sizeof(Keep) - 2);
+}
+
+void ResetLogAdd(char cause) {
+    if(ResetLog.crc != KeepCRC(&ResetLog, sizeof(ResetLog) - 2)) memset(&ResetLog, 0, sizeof(ResetLog));
+    else if(ResetLog.boots < 0xFFFF) ResetLog.boots++;
+    memmove(&ResetLog.cause[1], &ResetLog.cause[0], KEEP_LOG-1);
+    ResetLog.cause[0] = cause;
+    ResetLog.crc = KeepCRC(&ResetLog, sizeof(ResetLog) - 2);
+}
+
+uint8_t KeepRestore() {
+    uint8_t i, remain, valid;
+    char cause;
+
+    /* CAUSE FROM SEAL, ELSE FROM MCUSR */
+    valid = (wdt_reset_cause & (1<<WDRF)) && Keep.magic == KEEP_MAGIC && Keep.crc == KeepCRC(&Keep, sizeof(Keep) - 2);
+    if(valid) cause = Keep.cause;
+    else if(wdt_reset_cause & (1<<PORF)) cause = 'P';
+    else if(wdt_reset_cause & (1<<BORF)) cause = 'B';
+    else if(wdt_reset_cause & (1<<EXTRF)) cause = 'E';
+    else cause = 'W';
+    ResetLogAdd(cause);
+
+    if(!valid) {
+        memset(&Keep, 0, sizeof(Keep));
+        return 0;
+    }
+    Keep.magic = 0;                             // Valid only once
+
+    /* HANG, FRAME OR SCHEDULE STATE MAY BE THE CAUSE */
+    if(cause == 'H') {
+        memset(Keep.DupFrame, 0, sizeof(Keep.DupFrame));
+        return 0;
+    }
+
+    /* BEACON OVERDUE AT RESET ARE DUE NOW */
+    for(i=0; i<BCN_COUNT; i++) {
+        if(Keep.BeaconTime[i] == BCN_NEVER) continue;
+        Keep.BeaconTime[i] = (Keep.BeaconTime[i] > Keep.clk) ? Keep.BeaconTime[i] - Keep.clk + wdt_clk : wdt_clk;
+    }
+
+    /* DUPLICATE EXPIRE TIME, LOW BYTE OF WDT_CLK */
+    for(i=0; i<DUP_MAXFRAME; i++) {
+        remain = Keep.DupFrame[i].time - (uint8_t)Keep.clk;
+        if(Keep.DupFrame[i].time == 0 || (int8_t)remain <= 0) Keep.DupFrame[i].time = 0;
+        else if((Keep.DupFrame[i].time = (uint8_t)(wdt_clk + remain)) == 0) Keep.DupFrame[i].time = 1;
+    }
+    return 1;
+}
+
+
 /******************************************************************************
  * void DigiInit()
  *
  * Initialize digi radio module.
  *****************************************************************************/
 int DigiInit() {
-    Beacon1Timer = wdt_clk + (uint32_t)B1_INTERVAL;
-    Beacon2Timer = wdt_clk + (uint32_t)B2_INTERVAL;
-    Beacon3Timer = wdt_clk + (uint32_t)B3_INTERVAL;
-    TelemTimer   = wdt_clk + (uint32_t)TELEM_INTERVAL; 
-    return DigiWake();
+    #ifdef __AVR__
+    StackPaint();
+    #endif
+    asc2AXcall(MYCALL, NodeCall);
+    sprintf_P(MsgHeader, PSTR(":%-9s:"), MYCALL);
+    ConfigLoad();
+    ChannelBackoff();
+    lora.setRxFilter(DigiRxFilter);
+
+    /* JITTER DIFFERENT ON EACH DIGI */
+    uint16_t seed = 0xFFFF;
+    for(uint8_t i=0; i<7; i++) seed = DoCRC(seed, NodeCall[i]);
+    randomSeed(seed ^ analogRead(BATT_VOLT));
+
+    /* STATE BEFORE WATCHDOG RESET, ELSE (OR AFTER HANG) FIRST BEACON SCHEDULE */
+    if(!KeepRestore()) {
+        for(uint8_t i=0; i<BCN_META; i++) BeaconSchedule(i);
+        #if BCN_COMPRESSED==1 || (VOLT_ENABLE==0 && BMP180_ENABLE==0 && DS_ENABLE==0)
+        Keep.BeaconTime[BCN_TELEM] = BCN_NEVER;      // Telemetry in position comment, or no sensor
+        #endif
+        #if VOLT_ENABLE==1 || BMP180_ENABLE==1 || DS_ENABLE==1
+        Keep.BeaconTime[BCN_META] = wdt_clk + BCN_META_BOOT;
+        Keep.MetaInterval = BCN_META_MIN;
+        #else
+        Keep.BeaconTime[BCN_META] = BCN_NEVER;
+        #endif
+    }
+    AirtimeTimer = wdt_clk + 600;
+    AfcTimer     = wdt_clk + AFC_INTERVAL;
+    ChannelTimer = wdt_clk + CHANNEL_LOAD_INTERVAL;
+    return DigiRadioInit();
 }
@@ -7,6 +7,9 @@ int DigiInit();
 void DigiSleep();
 int DigiWake();
 int DigiPoll();
-void DigiSendBeacon(uint8_t id);
+void DigiFlush();
+uint32_t DigiNextEvent();
+void DigiSeal(char cause);
+bool DigiSendBeacon(uint8_t id, bool telem = false);
 
 #endif
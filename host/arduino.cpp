@@ -0,0 +1,310 @@
+/******************************************************************************
+ * Arduino core for host build
+ *
+ * Time only move by delay(), SPI byte (4 us at 2 MHz), millis() call (1 us)
+ * and sleep. Sleep run time up to next IRQ: watchdog period from WDTCSR
+ * prescaler, DIO0 pin change from SX1278 emulator. Like AVR, millis() stop
+ * in power down and timer 0 wake CPU each ms in idle sleep. IRQ wait while
+ * I bit of SREG is clear (cli, SPI transaction).
+ *****************************************************************************/
+#include "project.h"
+#include "host.h"
+
+#include <SPI.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+#include <avr/eeprom.h>
+#include <DallasTemperature.h>
+#include <Adafruit_BMP085.h>
+
+extern "C" void WDT_vect(void) __attribute__((weak));
+extern "C" void PCINT2_vect(void) __attribute__((weak));
+
+SX1278Emu Radio;
+SPIClass SPI;
+HostSreg SREG;
+HostWdtcsr WDTCSR;
+uint8_t MCUSR;
+uint8_t PCMSK2, PCICR;
+
+float DallasTemperature :: Temp = 20.0;
+int32_t Adafruit_BMP085 :: Pressure = 101300;
+float Adafruit_BMP085 :: Temp = 25.0;
+
+uint64_t HostUs;
+uint16_t HostAnalog[22];
+uint32_t HostWake;
+uint64_t HostSleepUs;
+jmp_buf *HostResetJump;
+
+static uint64_t MillisUs;           // Timer 0, stopped in power down
+static uint64_t WdtLast, WdtPeriod, WdtNext = UINT64_MAX;
+static uint8_t WdtPending, PcintPending, InIrq, Dio0Last;
+static uint8_t SleepMode, SleepEnable;
+static uint32_t RandomNext = 1;
+
+
+/******************************************************************************
+ * IRQ
+ *****************************************************************************/
+static void HostIrq() {
+    if(InIrq) return;
+    while((SREG & bit(SREG_I)) && (PcintPending || WdtPending)) {
+        InIrq = 1;
+        SREG = SREG & ~bit(SREG_I);
+        if(PcintPending) {
+            PcintPending = 0;
+            if(PCINT2_vect) PCINT2_vect();
+        } else {
+            WdtPending = 0;
+            if(WDT_vect) WDT_vect();
+        }
+        InIrq = 0;
+        SREG = SREG | bit(SREG_I);
+    }
+}
+
+/* CHECK IRQ SOURCE AT CURRENT TIME */
+static void HostPoll() {
+    uint8_t dio0;
+
+    Radio.Update(HostUs);
+    dio0 = Radio.Dio0();
+    if(dio0 != Dio0Last && (PCICR & bit(2)) && (PCMSK2 & bit(LORA_DIO))) PcintPending = 1;
+    Dio0Last = dio0;
+    if(HostUs >= WdtNext) {
+        WdtPending = 1;
+        WdtLast = WdtNext;
+        WdtNext += WdtPeriod;
+    }
+}
+
+/* RUN TIME TO TARGET, STOP AT FIRST IRQ IF WAKE IS SET (SLEEP) */
+static void HostStep(uint64_t target, uint8_t wake) {
+    uint64_t next;
+
+    while(HostUs < target) {
+        next = target;
+        if(WdtNext < next) next = WdtNext;
+        if(Radio.NextEvent() < next) next = Radio.NextEvent();
+        if(next < HostUs) next = HostUs;
+        if(!(SleepMode == SLEEP_MODE_PWR_DOWN && wake)) MillisUs += next - HostUs;
+        HostUs = next;
+        HostPoll();
+        if((SREG & bit(SREG_I)) && (PcintPending || WdtPending)) {
+            HostIrq();
+            if(wake) return;
+        }
+    }
+}
+
+void HostRun(uint64_t us) {
+    HostStep(HostUs + us, 0);
+}
+
+void cli(void) {
+    SREG = SREG & ~bit(SREG_I);
+}
+
+void sei(void) {
+    SREG = SREG | bit(SREG_I);
+}
+
+HostSreg &HostSreg :: operator=(uint8_t value) {
+    _value = value;
+    if(value & bit(SREG_I)) HostIrq();
+    return *this;
+}
+
+
+/******************************************************************************
+ * Watchdog: IRQ period from prescaler (1 s at WDP2|WDP1), WDE without WDIE
+ * reset CPU.
+ *****************************************************************************/
+HostWdtcsr &HostWdtcsr :: operator=(uint8_t value) {
+    uint8_t n;
+
+    _value = value;
+    if((value & bit(WDE)) && !(value & bit(WDIE))) {
+        if(value & bit(WDCE)) return *this;     // Timed sequence start
+        MCUSR |= bit(WDRF);
+        if(HostResetJump) longjmp(*HostResetJump, 1);
+        fprintf(stderr, "host: watchdog reset at %.3f s\n", HostUs / 1e6);
+        exit(3);
+    }
+    if(!(value & bit(WDIE))) {
+        WdtNext = UINT64_MAX;
+        return *this;
+    }
+    n = (value & 0x07) | ((value & bit(WDP3)) ? 8 : 0);
+    WdtPeriod = (n >= 6) ? HOST_SEC << (n - 6) : 16000ULL << n;
+    WdtNext = WdtLast + WdtPeriod;
+    if(WdtNext <= HostUs) WdtNext = HostUs + WdtPeriod;
+    return *this;
+}
+
+void wdt_reset(void) {
+    WdtLast = HostUs;
+    if(WdtNext != UINT64_MAX) WdtNext = HostUs + WdtPeriod;
+}
+
+
+/******************************************************************************
+ * Sleep
+ *****************************************************************************/
+void set_sleep_mode(uint8_t mode) {
+    SleepMode = mode;
+}
+
+void sleep_enable(void) {
+    SleepEnable = 1;
+}
+
+void sleep_disable(void) {
+    SleepEnable = 0;
+}
+
+void sleep_cpu(void) {
+    uint64_t start = HostUs;
+
+    if(!SleepEnable) return;
+    if(!(SREG & bit(SREG_I))) {
+        fprintf(stderr, "host: sleep with IRQ disabled at %.3f s\n", HostUs / 1e6);
+        exit(3);
+    }
+
+    /* IDLE: TIMER 0 IRQ WAKE CPU EACH MS */
+    if(SleepMode != SLEEP_MODE_PWR_DOWN) {
+        HostStep(HostUs + 1024, 1);
+        return;
+    }
+
+    if(WdtNext == UINT64_MAX && Radio.NextEvent() == UINT64_MAX) {
+        fprintf(stderr, "host: power down without wake-up source at %.3f s\n", HostUs / 1e6);
+        exit(3);
+    }
+    HostStep(UINT64_MAX, 1);
+    HostWake++;
+    HostSleepUs += HostUs - start;
+}
+
+void sleep_mode(void) {
+    sleep_enable();
+    sleep_cpu();
+    sleep_disable();
+}
+
+
+/******************************************************************************
+ * Pin, time, random
+ *****************************************************************************/
+void pinMode(uint8_t pin, uint8_t mode) {
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    if(pin == LORA_CS) Radio.Select(val);
+    if(pin == LORA_RESET && val == LOW) Radio.Reset();
+    HostPoll();
+}
+
+int digitalRead(uint8_t pin) {
+    Radio.Update(HostUs);
+    if(pin == LORA_DIO) return Radio.Dio0();
+    return LOW;
+}
+
+int analogRead(uint8_t pin) {
+    return (pin < sizeof(HostAnalog) / 2) ? HostAnalog[pin] : 0;
+}
+
+void analogReference(uint8_t mode) {
+}
+
+unsigned long millis(void) {
+    HostRun(1);
+    return MillisUs / 1000;
+}
+
+unsigned long micros(void) {
+    return MillisUs;
+}
+
+void delay(unsigned long ms) {
+    HostRun(ms * 1000ULL);
+}
+
+void delayMicroseconds(unsigned int us) {
+    HostRun(us);
+}
+
+/* AVR-LIBC RANDOM(), PARK-MILLER */
+static long HostRandom() {
+    long hi, lo, x = RandomNext;
+
+    if(x == 0) x = 123459876L;
+    hi = x / 127773L;
+    lo = x % 127773L;
+    x = 16807L * lo - 2836L * hi;
+    if(x < 0) x += 0x7FFFFFFFL;
+    RandomNext = x;
+    return x;
+}
+
+long random(long howbig) {
+    if(howbig == 0) return 0;
+    return HostRandom() % howbig;
+}
+
+long random(long howsmall, long howbig) {
+    if(howsmall >= howbig) return howsmall;
+    return random(howbig - howsmall) + howsmall;
+}
+
+void randomSeed(unsigned long seed) {
+    if(seed != 0) RandomNext = seed;
+}
+
+char *dtostrf(double val, signed char width, unsigned char prec, char *s) {
+    sprintf(s, "%*.*f", width, prec, val);
+    return s;
+}
+
+
+/******************************************************************************
+ * SPI, byte to SX1278 emulator
+ *****************************************************************************/
+void SPIClass :: begin() {
+}
+
+void SPIClass :: usingInterrupt(uint8_t n) {
+    _irq = (n == 255);
+}
+
+void SPIClass :: beginTransaction(SPISettings s) {
+    if(_irq) {
+        _sreg = SREG;
+        cli();
+    }
+}
+
+void SPIClass :: endTransaction() {
+    if(_irq) SREG = _sreg;
+}
+
+uint8_t SPIClass :: transfer(uint8_t data) {
+    uint8_t in = Radio.Transfer(data);
+    HostRun(4);
+    return in;
+}
+
+
+/******************************************************************************
+ * EEPROM
+ *****************************************************************************/
+void eeprom_read_block(void *dst, const void *src, size_t n) {
+    memcpy(dst, src, n);
+}
+
+void eeprom_update_block(const void *src, void *dst, size_t n) {
+    memcpy(dst, src, n);
+}
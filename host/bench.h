@@ -0,0 +1,28 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <time.h>
+
+/* HOST CPU TIME IN NS PER CALL OF EXPRESSION, BEST OF 5 RUN OF N CALL.
+   HOST NUMBER ONLY COMPARE TWO CODE, AVR CYCLE ARE NOT MEASURED */
+static volatile uint32_t BenchSink;
+
+static double BenchNow() {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+#define BENCH(ns, n, expr) do {                                 \
+    double best = 1e30, t0;                                     \
+    for(int r=0; r<5; r++) {                                    \
+        t0 = BenchNow();                                        \
+        for(long k=0; k<(n); k++) BenchSink += (expr);          \
+        if(BenchNow() - t0 < best) best = BenchNow() - t0;      \
+    }                                                           \
+    ns = best / (n);                                            \
+} while(0)
+
+#endif
@@ -0,0 +1,61 @@
+/******************************************************************************
+ * DoCRC(): old bit-serial loop against nibble table, on frame data of 50, 
+ * 150 and 250 bytes. Per frame, old code hashed a digipeated frame twice 
+ * (TestDup and AddDupList), new one once (Fingerprint).
+ *****************************************************************************/
+#include "project.h"
+#include "bench.h"
+#include "test.h"
+
+#include <stdlib.h>
+
+unsigned short DoCRC(unsigned short crc, unsigned char c);
+
+/* DOCRC BEFORE NIBBLE TABLE, NOT INLINED LIKE DOCRC() OF DIGI.CPP */
+__attribute__((noinline)) static unsigned short DoCRCBit(unsigned short crc, unsigned char c) {
+    unsigned short xor_int;
+
+    for (uint8_t i=0; i<8; i++) {
+        xor_int = crc ^ (c&1);
+        crc>>=1;
+        if(xor_int & 0x0001) crc ^= 0x8408;
+        c >>=1;
+    }
+    return crc;
+}
+
+static uint16_t CrcBit(const uint8_t *p, int size) {
+    uint16_t crc = 0xFFFF;
+
+    for(int i=0; i<size; i++) crc = DoCRCBit(crc, p[i]);
+    return crc;
+}
+
+static uint16_t CrcNibble(const uint8_t *p, int size) {
+    uint16_t crc = 0xFFFF;
+
+    for(int i=0; i<size; i++) crc = DoCRC(crc, p[i]);
+    return crc;
+}
+
+int main() {
+    static const int Size[] = { 50, 150, 250 };
+    uint8_t buf[255];
+    double bit, nibble;
+
+    /* SAME CRC ON RANDOM PAYLOAD */
+    srand(1);
+    for(int n=1; n<255; n++) {
+        for(int i=0; i<n; i++) buf[i] = rand();
+        CHECK(CrcBit(buf, n) == CrcNibble(buf, n));
+    }
+
+    printf("%6s %12s %12s %7s %14s %14s\n", "bytes", "bit ns", "nibble ns", "ratio", "old frame ns", "new frame ns");
+    for(int s=0; s<3; s++) {
+        BENCH(bit, 200000, CrcBit(buf, Size[s]));
+        BENCH(nibble, 200000, CrcNibble(buf, Size[s]));
+        printf("%6d %12.1f %12.1f %7.2f %14.1f %14.1f\n", Size[s], bit, nibble, bit / nibble, 2 * bit, nibble);
+    }
+
+    TEST_END();
+}
@@ -0,0 +1,94 @@
+/******************************************************************************
+ * Header parsing: scan done by receive path before the shared descriptor
+ * (final bit check, heard via loop, data index, repeated bit, insert
+ * position, message header built by sprintf) against one FrameParse() and
+ * compare with MsgHeader. AX.25 and OE ASCII frame, 1 and 3 path entry.
+ *****************************************************************************/
+#include "project.h"
+#include "bench.h"
+#include "test.h"
+#include "ax25_util.h"
+
+#include <string.h>
+
+struct TFrameView;
+uint8_t FrameParse(unsigned char *packet, uint8_t length, struct TFrameView *v);
+int DigiInit();
+extern char MsgHeader[12];
+
+/* DESCRIPTOR IS PRIVATE TO DIGI.CPP, ALL UINT8_T, 64 BYTES IS ENOUGH */
+static uint8_t View[64];
+
+/* AX25 SCAN BEFORE DESCRIPTOR, RETURN INSERT POSITION */
+static uint8_t OldScanAX25(unsigned char *packet, uint8_t length) {
+    uint8_t i, c, via, DataIndex, PathIndex;
+    char tmp[12];
+
+    if(length<17) return 0;
+    for(i=0; i<length; i++) { c=packet[i]; if((c & 1) == 1) break; }
+    if((c&1) == 0) return 0;
+    if(((i+1)%7) != 0) return 0;
+    if(i==6) return 0;
+    for(c=0, i=20; i<length && (packet[i-7]&1)==0; i+=7) if(packet[i]&0x80) c=1;
+    for(DataIndex=0; DataIndex<length; DataIndex++) if(packet[DataIndex]&1) break;
+    if(packet[++DataIndex]!=0x03) return 0;
+    DataIndex+=2;
+    for(via=0, i=20; i<DataIndex-2; i+=7) if(packet[i]&0x80) via=1;
+    sprintf(tmp, ":%-9s:", MYCALL);
+    if(memcmp(&packet[DataIndex], tmp, 11) == 0) return 0;
+    PathIndex = 14;
+    while((packet[PathIndex-1]&1)==0 && (packet[PathIndex+6]&128)!=0) PathIndex+=7;
+    return PathIndex + via + c;
+}
+
+/* OE SCAN BEFORE DESCRIPTOR, RETURN INSERT POSITION */
+static uint8_t OldScanOE(unsigned char *h, uint8_t length) {
+    uint8_t i, gt, dst_end, colon, star;
+    unsigned char src[7];
+    char tmp[12];
+
+    for(gt=3; gt<length && h[gt]!='>'; gt++);
+    for(colon=gt; colon<length && h[colon]!=':'; colon++);
+    if(gt >= colon || colon >= length) return 0;
+    for(dst_end=gt; dst_end<colon && h[dst_end]!=','; dst_end++);
+    for(star=0, i=dst_end; i<colon; i++) if(h[i]=='*') star=i;
+    asc2AXcall((char*)&h[3], src);
+    sprintf(tmp, ":%-9s:", MYCALL);
+    if(memcmp(&h[colon+1], tmp, 11) == 0) return 0;
+    return (star ? star+1 : dst_end) + 1 + src[0];
+}
+
+/* DESCRIPTOR AND MESSAGE HEADER COMPARE (SAME COST AT ANY OFFSET) */
+static uint8_t NewParse(unsigned char *packet, uint8_t length) {
+    if(!FrameParse(packet, length, (struct TFrameView *)View)) return 0;
+    return memcmp(MsgHeader, &packet[length - 11], 11) != 0;
+}
+
+int main() {
+    static const char *Frame[] = {
+        "N0CALL-9>APRS,WIDE2-2:!4903.50N/07201.75W>Mobile 144.390 test frame",
+        "N0CALL-9>APRS,VE2AAA-1*,WIDE1*,WIDE2-1:!4903.50N/07201.75W>Mobile 144.390 test frame",
+    };
+    uint8_t ax[2][256], oe[2][256], axlen[2], oelen[2];
+    double old_ns, new_ns;
+
+    DigiInit();
+    for(int f=0; f<2; f++) {
+        axlen[f] = EncodeAX25((char*)Frame[f], ax[f]);
+        oelen[f] = sprintf((char*)oe[f], "<\xFF\x01%s", Frame[f]);
+        CHECK(FrameParse(ax[f], axlen[f], (struct TFrameView *)View) && OldScanAX25(ax[f], axlen[f]));
+        CHECK(FrameParse(oe[f], oelen[f], (struct TFrameView *)View) && OldScanOE(oe[f], oelen[f]));
+    }
+
+    printf("%-14s %10s %10s %7s\n", "frame", "old ns", "new ns", "ratio");
+    for(int f=0; f<2; f++) {
+        BENCH(old_ns, 500000, OldScanAX25(ax[f], axlen[f]));
+        BENCH(new_ns, 500000, NewParse(ax[f], axlen[f]));
+        printf("AX.25 %d hop%s %10.1f %10.1f %7.2f\n", f ? 3 : 1, f ? "s" : " ", old_ns, new_ns, old_ns / new_ns);
+        BENCH(old_ns, 500000, OldScanOE(oe[f], oelen[f]));
+        BENCH(new_ns, 500000, NewParse(oe[f], oelen[f]));
+        printf("OE    %d hop%s %10.1f %10.1f %7.2f\n", f ? 3 : 1, f ? "s" : " ", old_ns, new_ns, old_ns / new_ns);
+    }
+
+    TEST_END();
+}
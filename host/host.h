@@ -0,0 +1,29 @@
+#ifndef HOST_H
+#define HOST_H
+
+#include <stdint.h>
+#include <setjmp.h>
+
+#include "sx1278_emu.h"
+
+/* HOST TIME IN US, CPU TIME IS ONLY SPI BUS AND DELAY, REST IS FREE */
+#define HOST_SEC 1000000ULL
+extern uint64_t HostUs;
+
+/* SX1278 ON LORA_CS, LORA_RESET AND LORA_DIO PIN */
+extern SX1278Emu Radio;
+
+/* ANALOG INPUT VALUE (0-1023) */
+extern uint16_t HostAnalog[22];
+
+/* SLEEP STAT: WAKE-UP FROM POWER DOWN, TIME IN POWER DOWN */
+extern uint32_t HostWake;
+extern uint64_t HostSleepUs;
+
+/* WATCHDOG RESET JUMP HERE (LONGJMP) IF SET, ELSE PROGRAM EXIT */
+extern jmp_buf *HostResetJump;
+
+/* RUN TIME FORWARD, WATCHDOG AND DIO0 IRQ ARE CALLED WHEN ENABLED */
+void HostRun(uint64_t us);
+
+#endif
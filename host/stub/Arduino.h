@@ -0,0 +1,57 @@
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+/* ARDUINO CORE FOR HOST BUILD, SEE HOST/ARDUINO.CPP */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <math.h>
+#include <avr/pgmspace.h>
+#include <avr/interrupt.h>
+
+/* GLIBC INDEX() FUNCTION HIDE DIGI.CPP VARIABLE */
+#define index pkt_index
+
+/* ATMEGA328P, RAM BUDGET CHECK ONLY (HOST POINTER AND PADDING ARE LARGER) */
+#ifndef RAMEND
+#define RAMEND   0x10FF
+#endif
+#ifndef RAMSTART
+#define RAMSTART 0x100
+#endif
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INTERNAL 3
+#define A0 14
+#define A7 21
+
+#define bit(b) (1UL << (b))
+#define constrain(a,l,h) ((a)<(l)?(l):((a)>(h)?(h):(a)))
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogReference(uint8_t mode);
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+char *dtostrf(double val, signed char width, unsigned char prec, char *s);
+
+/* PIN CHANGE INTERRUPT, PCINT2 FOR D0-D7 ONLY */
+extern uint8_t PCMSK2, PCICR;
+#define digitalPinToPCMSK(p)    (&PCMSK2)
+#define digitalPinToPCMSKbit(p) (p)
+#define digitalPinToPCICR(p)    (&PCICR)
+#define digitalPinToPCICRbit(p) 2
+
+#endif
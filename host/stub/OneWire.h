@@ -0,0 +1,11 @@
+#ifndef ONEWIRE_H
+#define ONEWIRE_H
+
+#include <stdint.h>
+
+class OneWire {
+  public:
+    OneWire(uint8_t pin) {}
+};
+
+#endif
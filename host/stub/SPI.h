@@ -0,0 +1,27 @@
+#ifndef SPI_H
+#define SPI_H
+
+#include <Arduino.h>
+
+#define MSBFIRST  1
+#define SPI_MODE0 0
+
+struct SPISettings {
+    SPISettings(uint32_t clock, uint8_t order, uint8_t mode) {}
+};
+
+/* BYTE GO TO SX1278 EMULATOR, USINGINTERRUPT() MASK IRQ IN TRANSACTION */
+class SPIClass {
+  public:
+    void begin();
+    void usingInterrupt(uint8_t n);
+    void beginTransaction(SPISettings s);
+    void endTransaction();
+    uint8_t transfer(uint8_t data);
+  private:
+    uint8_t _irq, _sreg;
+};
+
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef EEPROM_H
+#define EEPROM_H
+
+#include <stddef.h>
+
+/* EEMEM VARIABLE STAY IN HOST RAM, KEEPED ACROSS HOST RESET */
+#define EEMEM
+
+void eeprom_read_block(void *dst, const void *src, size_t n);
+void eeprom_update_block(const void *src, void *dst, size_t n);
+
+#endif
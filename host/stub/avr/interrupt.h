@@ -0,0 +1,49 @@
+#ifndef INTERRUPT_H
+#define INTERRUPT_H
+
+#include <stdint.h>
+
+/* STATUS REGISTER, SETTING I BIT RUN PENDING IRQ (HOST/ARDUINO.CPP) */
+class HostSreg {
+  public:
+    operator uint8_t() const { return _value; }
+    HostSreg &operator=(uint8_t value);
+  private:
+    uint8_t _value;
+};
+
+/* WATCHDOG CONTROL, PRESCALER SET HOST IRQ PERIOD, WDE ALONE RESET CPU */
+class HostWdtcsr {
+  public:
+    operator uint8_t() const { return _value; }
+    HostWdtcsr &operator=(uint8_t value);
+    HostWdtcsr &operator|=(uint8_t value) { return *this = _value | value; }
+  private:
+    uint8_t _value;
+};
+
+extern HostSreg SREG;
+extern HostWdtcsr WDTCSR;
+extern uint8_t MCUSR;
+
+#define SREG_I 7
+#define PORF   0
+#define EXTRF  1
+#define BORF   2
+#define WDRF   3
+#define WDP0   0
+#define WDP1   1
+#define WDP2   2
+#define WDE    3
+#define WDCE   4
+#define WDP3   5
+#define WDIE   6
+
+#define ISR(vector) extern "C" void vector(void)
+
+void cli(void);
+void sei(void);
+#define noInterrupts() cli()
+#define interrupts()   sei()
+
+#endif
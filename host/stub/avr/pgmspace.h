@@ -0,0 +1,25 @@
+#ifndef PGMSPACE_H
+#define PGMSPACE_H
+
+/* FLASH AND RAM ARE THE SAME ON HOST */
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+#define pgm_read_byte(a)  (*(const uint8_t *)(a))
+#define pgm_read_word(a)  (*(const uint16_t *)(a))
+#define pgm_read_dword(a) (*(const uint32_t *)(a))
+#define memcpy_P   memcpy
+#define memcmp_P   memcmp
+#define strlen_P   strlen
+#define strcpy_P   strcpy
+#define strncpy_P  strncpy
+#define strcmp_P   strcmp
+#define strncmp_P  strncmp
+#define sprintf_P  sprintf
+#define snprintf_P snprintf
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef SLEEP_H
+#define SLEEP_H
+
+/* SLEEP RUN HOST TIME UP TO NEXT IRQ, MILLIS() STOP IN POWER DOWN */
+#define SLEEP_MODE_IDLE     0
+#define SLEEP_MODE_PWR_DOWN 2
+
+void set_sleep_mode(uint8_t mode);
+void sleep_enable(void);
+void sleep_disable(void);
+void sleep_cpu(void);
+void sleep_mode(void);
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef WDT_H
+#define WDT_H
+
+void wdt_reset(void);
+
+#endif
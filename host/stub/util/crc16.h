@@ -0,0 +1,13 @@
+#ifndef CRC16_H
+#define CRC16_H
+
+#include <stdint.h>
+
+/* AVR-LIBC CRC-16 (0xA001 REFLECTED) */
+static inline uint16_t _crc16_update(uint16_t crc, uint8_t a) {
+    crc ^= a;
+    for(uint8_t i=0; i<8; i++) crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : (crc >> 1);
+    return crc;
+}
+
+#endif
@@ -0,0 +1,343 @@
+
+#include "sx1278_emu.h"
+
+#include <string.h>
+
+#define NEVER UINT64_MAX
+
+/* LORA MODE REGISTER */
+#define REG_FIFO            0x00
+#define REG_OP_MODE         0x01
+#define REG_FIFO_ADDR_PTR   0x0D
+#define REG_FIFO_TX_BASE    0x0E
+#define REG_FIFO_RX_BASE    0x0F
+#define REG_FIFO_RX_CURRENT 0x10
+#define REG_IRQ_FLAGS_MASK  0x11
+#define REG_IRQ_FLAGS       0x12
+#define REG_RX_NB_BYTES     0x13
+#define REG_MODEM_STAT      0x18
+#define REG_PKT_SNR         0x19
+#define REG_PKT_RSSI        0x1A
+#define REG_RSSI            0x1B
+#define REG_MODEM_CONFIG_1  0x1D
+#define REG_MODEM_CONFIG_2  0x1E
+#define REG_PREAMBLE_MSB    0x20
+#define REG_PREAMBLE_LSB    0x21
+#define REG_PAYLOAD_LENGTH  0x22
+#define REG_FIFO_RX_BYTE    0x25
+#define REG_MODEM_CONFIG_3  0x26
+#define REG_FEI_MSB         0x28
+#define REG_DIO_MAPPING_1   0x40
+#define REG_VERSION         0x42
+
+#define MODE_SLEEP   0
+#define MODE_STANDBY 1
+#define MODE_TX      3
+#define MODE_RXCONT  5
+#define MODE_CAD     7
+
+#define IRQ_RX_DONE      0x40
+#define IRQ_CRC_ERROR    0x20
+#define IRQ_VALID_HEADER 0x10
+#define IRQ_TX_DONE      0x08
+#define IRQ_CAD_DONE     0x04
+#define IRQ_CAD_DETECTED 0x01
+
+static const uint32_t BandwidthHz[] = { 7800, 10400, 15600, 20800, 31250, 41700, 62500, 125000, 250000, 500000 };
+
+SX1278Emu :: SX1278Emu() {
+    SpiCount = 0;
+    SpiBytes = 0;
+    RxOk = 0;
+    RxMissed = 0;
+    Collision = 0;
+    TxTime = 0;
+    _now = 0;
+    Reset();
+}
+
+/******************************************************************************
+ * Reset()
+ *
+ * Power on or RESET pin value (datasheet register default), FSK standby.
+ * Frame on air are keeped, they are not part of the chip.
+ *****************************************************************************/
+void SX1278Emu :: Reset() {
+    memset(_reg, 0, sizeof(_reg));
+    memset(_fifo, 0, sizeof(_fifo));
+    _reg[REG_OP_MODE] = 0x09;
+    _reg[0x06] = 0x6C;
+    _reg[0x07] = 0x80;
+    _reg[0x09] = 0x4F;
+    _reg[0x0B] = 0x2B;
+    _reg[0x0C] = 0x20;
+    _reg[REG_FIFO_TX_BASE] = 0x80;
+    _reg[REG_MODEM_CONFIG_1] = 0x72;
+    _reg[REG_MODEM_CONFIG_2] = 0x70;
+    _reg[REG_PREAMBLE_LSB] = 0x08;
+    _reg[REG_PAYLOAD_LENGTH] = 0x01;
+    _reg[0x23] = 0xFF;
+    _reg[REG_MODEM_CONFIG_3] = 0x04;
+    _reg[0x31] = 0xC3;
+    _reg[0x37] = 0x0A;
+    _reg[0x39] = 0x12;
+    _reg[REG_VERSION] = 0x12;
+    _reg[0x4D] = 0x84;
+    _cs = 1;
+    _first = 0;
+    _txEnd = NEVER;
+    _cadEnd = NEVER;
+    _rxSince = NEVER;
+    _rxWrite = 0;
+}
+
+/******************************************************************************
+ * SPI: first byte after CS falling edge is address (bit 7 set to write),
+ * next bytes read or write register, address increment except on FIFO.
+ *****************************************************************************/
+void SX1278Emu :: Select(uint8_t level) {
+    if(_cs && !level) {
+        SpiCount++;
+        _first = 1;
+    }
+    _cs = level;
+}
+
+uint8_t SX1278Emu :: Transfer(uint8_t out) {
+    uint8_t in = 0xFF;
+
+    SpiBytes++;
+    if(_cs) return in;
+    if(_first) {
+        _first = 0;
+        _addr = out;
+        return 0;
+    }
+    if(_addr & 0x80) write(_addr & 0x7F, out);
+    else in = read(_addr);
+    if((_addr & 0x7F) != REG_FIFO) _addr = (_addr & 0x80) | ((_addr + 1) & 0x7F);
+    return in;
+}
+
+/* DIO0 FOLLOW IRQ FLAG SELECTED BY DIO_MAPPING_1 BIT 7-6 */
+uint8_t SX1278Emu :: Dio0() {
+    static const uint8_t map[4] = { IRQ_RX_DONE, IRQ_TX_DONE, IRQ_CAD_DONE, 0 };
+
+    return (_reg[REG_IRQ_FLAGS] & map[_reg[REG_DIO_MAPPING_1] >> 6]) ? 1 : 0;
+}
+
+void SX1278Emu :: write(uint8_t reg, uint8_t value) {
+    uint8_t mode = Mode();
+
+    switch(reg) {
+        case REG_FIFO:
+            if(mode != MODE_SLEEP) _fifo[_reg[REG_FIFO_ADDR_PTR]++] = value;
+            break;
+
+        /* LORA BIT ONLY CHANGE FROM SLEEP TO SLEEP (DRIVER CLEAR IT WHEN 
+           LEAVING SLEEP, REAL CHIP KEEP LORA MODE) */
+        case REG_OP_MODE:
+            if(mode != MODE_SLEEP || (value & 0x07) != MODE_SLEEP) value = (value & 0x7F) | (_reg[REG_OP_MODE] & 0x80);
+            _reg[REG_OP_MODE] = value;
+            setMode(value & 0x07);
+            break;
+
+        /* WRITE 1 TO CLEAR */
+        case REG_IRQ_FLAGS:
+            _reg[REG_IRQ_FLAGS] &= ~value;
+            break;
+
+        /* READ ONLY */
+        case REG_FIFO_RX_CURRENT:
+        case REG_RX_NB_BYTES:
+        case 0x14: case 0x15: case 0x16: case 0x17:
+        case REG_MODEM_STAT:
+        case REG_PKT_SNR:
+        case REG_PKT_RSSI:
+        case REG_RSSI:
+        case 0x1C:
+        case REG_FIFO_RX_BYTE:
+        case REG_FEI_MSB: case REG_FEI_MSB+1: case REG_FEI_MSB+2:
+        case REG_VERSION:
+            break;
+
+        default:
+            _reg[reg] = value;
+    }
+}
+
+uint8_t SX1278Emu :: read(uint8_t reg) {
+    switch(reg) {
+        case REG_FIFO:
+            if(Mode() == MODE_SLEEP) return 0;
+            return _fifo[_reg[REG_FIFO_ADDR_PTR]++];
+
+        /* SIGNAL DETECTED, SYNCED AND RX ONGOING WHILE FRAME ON AIR */
+        case REG_MODEM_STAT:
+            if(Mode() == MODE_RXCONT && onAir(_now)) return 0x07;
+            return 0x10;
+
+        case REG_RSSI:
+            for(auto &f : _air) if(f.start <= _now && _now < f.end) return f.rssi + 164;
+            return 164 - 125;
+    }
+    return _reg[reg];
+}
+
+/* MODE WRITTEN, START OR CANCEL TX, CAD AND RECEIVER */
+void SX1278Emu :: setMode(uint8_t mode) {
+    uint8_t len, i;
+    TEmuFrame f;
+
+    if(mode != MODE_TX) _txEnd = NEVER;
+    if(mode != MODE_CAD) _cadEnd = NEVER;
+    if(mode != MODE_RXCONT) _rxSince = NEVER;
+
+    switch(mode) {
+
+        /* FIFO IS CLEARED IN SLEEP */
+        case MODE_SLEEP:
+            memset(_fifo, 0, sizeof(_fifo));
+            break;
+
+        /* PAYLOAD_LENGTH BYTES FROM TX BASE ADDRESS */
+        case MODE_TX:
+            if(_txEnd != NEVER) break;
+            len = _reg[REG_PAYLOAD_LENGTH];
+            for(i=0; i<len; i++) f.data.push_back(_fifo[(uint8_t)(_reg[REG_FIFO_TX_BASE] + i)]);
+            f.start = _now;
+            f.end = _now + TimeOnAir(len);
+            f.rssi = 0;
+            f.snr = 0;
+            f.fei = 0;
+            f.crcError = false;
+            f.collided = false;
+            for(auto &a : _air) if(a.start < f.end && f.start < a.end) Collision++;
+            Sent.push_back(f);
+            TxTime += f.end - f.start;
+            _txEnd = f.end;
+            break;
+
+        /* CAD TAKE ABOUT 2 SYMBOL */
+        case MODE_CAD:
+            if(_cadEnd == NEVER) _cadEnd = _now + 2 * ((1000000ULL << (_reg[REG_MODEM_CONFIG_2] >> 4)) / BandwidthHz[_reg[REG_MODEM_CONFIG_1] >> 4]);
+            break;
+
+        case MODE_RXCONT:
+            if(_rxSince == NEVER) {
+                _rxSince = _now;
+                _rxWrite = _reg[REG_FIFO_RX_BASE];
+            }
+            break;
+    }
+}
+
+/******************************************************************************
+ * TimeOnAir(uint8_t len)
+ *
+ * Semtech formula from modem config register, in us.
+ *****************************************************************************/
+uint32_t SX1278Emu :: TimeOnAir(uint8_t len) {
+    uint8_t sf = _reg[REG_MODEM_CONFIG_2] >> 4;
+    uint8_t cr = (_reg[REG_MODEM_CONFIG_1] >> 1) & 0x07;
+    uint8_t ih = _reg[REG_MODEM_CONFIG_1] & 0x01;
+    uint8_t crc = (_reg[REG_MODEM_CONFIG_2] >> 2) & 0x01;
+    uint8_t de = (_reg[REG_MODEM_CONFIG_3] >> 3) & 0x01;
+    uint16_t preamble = (_reg[REG_PREAMBLE_MSB] << 8) | _reg[REG_PREAMBLE_LSB];
+    double tsym = (double)(1UL << sf) * 1000000.0 / BandwidthHz[_reg[REG_MODEM_CONFIG_1] >> 4];
+    int num = 8 * len - 4 * sf + 28 + 16 * crc - 20 * ih;
+    int den = 4 * (sf - 2 * de);
+    int nsym = 8;
+
+    if(num > 0) nsym += ((num + den - 1) / den) * (cr + 4);
+    return (uint32_t)((preamble + 4.25 + nsym) * tsym);
+}
+
+/* FRAME ON AIR AT TIME T */
+uint8_t SX1278Emu :: onAir(uint64_t t) {
+    for(auto &f : _air) if(f.start <= t && t < f.end) return 1;
+    return 0;
+}
+
+void SX1278Emu :: Air(uint64_t start, const uint8_t *data, uint8_t len, int16_t rssi, int8_t snr, int32_t fei, bool crcError) {
+    TEmuFrame f;
+
+    f.data.assign(data, data + len);
+    f.start = start;
+    f.end = start + TimeOnAir(len);
+    f.rssi = rssi;
+    f.snr = snr;
+    f.fei = fei;
+    f.crcError = crcError;
+    f.collided = false;
+    for(auto &a : _air) {
+        if(a.start < f.end && f.start < a.end) {
+            a.collided = true;
+            f.collided = true;
+        }
+    }
+    if(_txEnd != NEVER && f.start < _txEnd) Collision++;
+    _air.push_back(f);
+}
+
+/* END OF FRAME ON AIR, IN FIFO IF RECEIVER WAS ON FOR WHOLE FRAME AND NO OVERLAP */
+void SX1278Emu :: receive(TEmuFrame &f) {
+    uint8_t i, mask = _reg[REG_IRQ_FLAGS_MASK];
+    uint32_t fei = f.fei & 0xFFFFF;
+
+    if(f.collided || Mode() != MODE_RXCONT || _rxSince > f.start) {
+        RxMissed++;
+        return;
+    }
+
+    RxOk++;
+    _reg[REG_FIFO_RX_CURRENT] = _rxWrite;
+    for(i=0; i<f.data.size(); i++) _fifo[_rxWrite++] = f.data[i];
+    _reg[REG_FIFO_RX_BYTE] = _rxWrite;
+    _reg[REG_RX_NB_BYTES] = f.data.size();
+    _reg[REG_PKT_SNR] = (uint8_t)(f.snr * 4);
+    _reg[REG_PKT_RSSI] = f.rssi + 164;
+    _reg[REG_FEI_MSB] = fei >> 16;
+    _reg[REG_FEI_MSB+1] = fei >> 8;
+    _reg[REG_FEI_MSB+2] = fei;
+    _reg[REG_IRQ_FLAGS] |= (IRQ_RX_DONE | IRQ_VALID_HEADER | (f.crcError ? IRQ_CRC_ERROR : 0)) & ~mask;
+}
+
+/******************************************************************************
+ * Update(uint64_t now)
+ *
+ * Process TX end, CAD end and frame end in time order up to now.
+ *****************************************************************************/
+uint64_t SX1278Emu :: NextEvent() {
+    uint64_t t = _txEnd;
+
+    if(_cadEnd < t) t = _cadEnd;
+    for(auto &f : _air) if(f.end < t) t = f.end;
+    return t;
+}
+
+void SX1278Emu :: Update(uint64_t now) {
+    uint64_t t;
+    uint8_t mask;
+
+    while((t = NextEvent()) <= now) {
+        _now = t;
+        mask = _reg[REG_IRQ_FLAGS_MASK];
+        if(_txEnd == t) {
+            _txEnd = NEVER;
+            _reg[REG_IRQ_FLAGS] |= IRQ_TX_DONE & ~mask;
+            _reg[REG_OP_MODE] = (_reg[REG_OP_MODE] & 0xF8) | MODE_STANDBY;
+        }
+        if(_cadEnd == t) {
+            _cadEnd = NEVER;
+            _reg[REG_IRQ_FLAGS] |= (IRQ_CAD_DONE | (onAir(t) ? IRQ_CAD_DETECTED : 0)) & ~mask;
+            _reg[REG_OP_MODE] = (_reg[REG_OP_MODE] & 0xF8) | MODE_STANDBY;
+        }
+        for(auto &f : _air) if(f.end == t) receive(f);
+        for(size_t i=0; i<_air.size(); ) {
+            if(_air[i].end == t) _air.erase(_air.begin() + i);
+            else i++;
+        }
+    }
+    _now = now;
+}
@@ -0,0 +1,70 @@
+#ifndef SX1278_EMU_H
+#define SX1278_EMU_H
+
+#include <stdint.h>
+#include <vector>
+
+/******************************************************************************
+ * SX1278 emulator, LoRa mode, for host build
+ *
+ * Register map, 256 bytes FIFO, OP_MODE transition (TX, CAD and RX end by
+ * themself), IRQ_FLAGS, RX_NB_BYTES, FIFO pointer and DIO0 mapping. Driver
+ * is unmodified: SPI.transfer() and CS/RESET pin of host core end here.
+ *
+ * Frame on air are given by test with Air(), received if radio is in RX
+ * continuous for whole frame. Frame sent are keeped in Sent. Time is host
+ * time in us, set by Update().
+ *****************************************************************************/
+struct TEmuFrame {
+    uint64_t start, end;        // us on air
+    std::vector<uint8_t> data;
+    int16_t rssi;               // dbm
+    int8_t snr;                 // db
+    int32_t fei;                // Raw FEI register value (20 bits signed)
+    bool crcError;
+    bool collided;              // Overlap other frame, not received
+};
+
+class SX1278Emu {
+  public:
+    SX1278Emu();
+    void Reset();
+
+    /* SPI SIDE */
+    void Select(uint8_t level);     // CS pin, transaction start on falling edge
+    uint8_t Transfer(uint8_t out);
+    uint8_t Dio0();
+
+    /* TIME, EVENT PROCESSED UP TO NOW */
+    void Update(uint64_t now);
+    uint64_t NextEvent();           // us of next state change, UINT64_MAX if none
+
+    /* TEST SIDE */
+    void Air(uint64_t start, const uint8_t *data, uint8_t len, int16_t rssi = -100, int8_t snr = 5, int32_t fei = 0, bool crcError = false);
+    uint32_t TimeOnAir(uint8_t len);    // us, from modem register
+    uint8_t Reg(uint8_t reg) { return _reg[reg & 0x7F]; }
+    uint8_t Mode() { return _reg[0x01] & 0x07; }
+
+    std::vector<TEmuFrame> Sent;    // Frame transmitted
+    uint32_t SpiCount;              // CS transaction
+    uint32_t SpiBytes;              // Byte clocked, CS high or low
+    uint32_t RxOk, RxMissed;        // Frame on air received or not (radio not listening)
+    uint32_t Collision;             // Frame sent while other frame on air
+    uint32_t TxTime;                // us on air, own frame
+
+  private:
+    uint8_t _reg[128];
+    uint8_t _fifo[256];
+    uint8_t _cs, _addr, _first;
+    uint64_t _now, _txEnd, _cadEnd, _rxSince;
+    uint8_t _rxWrite;
+    std::vector<TEmuFrame> _air;
+
+    void write(uint8_t reg, uint8_t value);
+    uint8_t read(uint8_t reg);
+    void setMode(uint8_t mode);
+    void receive(TEmuFrame &f);
+    uint8_t onAir(uint64_t t);
+};
+
+#endif
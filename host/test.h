@@ -0,0 +1,12 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+
+/* CHECK PRINT FAILED CONDITION, TEST_END() GIVE EXIT CODE */
+static int TestFail;
+
+#define CHECK(c) do { if(!(c)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #c); TestFail++; } } while(0)
+#define TEST_END() do { printf("%s: %s\n", __FILE__, TestFail ? "FAILED" : "OK"); return TestFail ? 1 : 0; } while(0)
+
+#endif
@@ -0,0 +1,56 @@
+/******************************************************************************
+ * Own beacon airtime over 20 hours, position (B1, B2) and T# telemetry, with
+ * BCN_COMPRESSED 0 and 1 (make test build both). Compressed beacon carry
+ * telemetry in comment, no T# frame is sent.
+ *****************************************************************************/
+#include "project.h"
+#include "host.h"
+#include "test.h"
+
+#include <string>
+
+void setup();
+void loop();
+
+#define HOURS 20              // Under WD_REBOOT_VALUE
+
+int main() {
+    uint64_t pos_us = 0, telem_us = 0, other_us = 0;
+    int pos = 0, pos_telem = 0, telem = 0;
+
+    HostAnalog[BATT_VOLT] = 900;
+    MCUSR = bit(PORF);
+    setup();
+    while(HostUs < HOURS * 3600 * HOST_SEC) loop();
+
+    for(size_t i=0; i<Radio.Sent.size(); i++) {
+        std::string s(Radio.Sent[i].data.begin(), Radio.Sent[i].data.end());
+        std::string data = s.substr(s.find(':') + 1);
+        uint64_t us = Radio.Sent[i].end - Radio.Sent[i].start;
+
+        if(data[0] == '!') {
+            pos++;
+            pos_us += us;
+            if(data.find('|') != std::string::npos) pos_telem++;
+        } else if(data.compare(0, 2, "T#") == 0) {
+            telem++;
+            telem_us += us;
+        } else other_us += us;
+    }
+
+    printf("BCN_COMPRESSED=%d, %d hours\n", BCN_COMPRESSED, HOURS);
+    printf("  position  %3d frame (%d with telemetry) %6.0f ms/h\n", pos, pos_telem, pos_us / 1e3 / HOURS);
+    printf("  T#        %3d frame %29.0f ms/h\n", telem, telem_us / 1e3 / HOURS);
+    printf("  total     %40.0f ms/h\n", (pos_us + telem_us) / 1e3 / HOURS);
+    printf("  status and metadata %28.0f ms/h\n", other_us / 1e3 / HOURS);
+
+    CHECK(pos > 0);
+    #if BCN_COMPRESSED==1
+    CHECK(telem == 0 && pos_telem > 0);
+    CHECK((pos_us + telem_us) / HOURS < 14000000);      // Under 14 s per hour
+    #else
+    CHECK(telem > 0);                   // Some merged in position (BCN_MERGE)
+    #endif
+
+    TEST_END();
+}
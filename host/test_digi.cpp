@@ -0,0 +1,313 @@
+/******************************************************************************
+ * Whole sketch (DigiPro.ino, digi.cpp, sx1278.cpp...) against register
+ * emulator: digipeat, duplicate, alias, ack, query and config reply, sent 
+ * on air. Also built for ATmega168 (FRAME_POOL 2) and with VISCOUS_DELAY 5.
+ *****************************************************************************/
+#include "project.h"
+#include "host.h"
+#include "test.h"
+#include "ax25_util.h"
+#include "watchdog.h"
+
+#include <string>
+
+void setup();
+void loop();
+
+extern uint16_t AirtimeSlot[6];
+extern uint8_t AirtimeIndex;
+extern uint32_t AirtimeTimer;
+uint32_t ConfigMac(const char *text, uint8_t len);
+
+/* RUN MAIN LOOP FOR SEC */
+static void Run(uint32_t sec) {
+    uint64_t end = HostUs + sec * HOST_SEC;
+
+    while(HostUs < end) loop();
+}
+
+/* OE FRAME "SRC>DEST,PATH:DATA" ON AIR NOW */
+static void AirOE(const char *text, int16_t rssi = -95) {
+    std::string f = std::string("<\xFF\x01") + text;
+
+    Radio.Air(HostUs, (const uint8_t *)f.data(), f.size(), rssi, 6);
+}
+
+/* OE FRAME ON AIR WHEN NODE LISTEN, AIRED AGAIN IF MISSED (NODE WAS IN TX 
+   OR CAD), SO RESULT DON'T DEPEND ON OWN BEACON TIMING. RETURN END OF FRAME */
+static uint64_t AirRx(const char *text) {
+    std::string f = std::string("<\xFF\x01") + text;
+    uint32_t missed;
+    uint64_t end;
+
+    do {
+        while(Radio.Mode() != SX1278_RXCONTINUOUS) loop();
+        missed = Radio.RxMissed;
+        Radio.Air(HostUs, (const uint8_t *)f.data(), f.size(), -95, 6);
+        end = HostUs + Radio.TimeOnAir(f.size());
+        while(HostUs < end + 1000) loop();
+    } while(Radio.RxMissed != missed);
+    return end;
+}
+
+/* TWO FRAME BACK TO BACK, RETURN 0 IF ONE IS MISSED */
+static int AirPair(const char *first, const char *second) {
+    std::string f1 = std::string("<\xFF\x01") + first;
+    std::string f2 = std::string("<\xFF\x01") + second;
+    uint32_t missed;
+    uint64_t end;
+
+    while(Radio.Mode() != SX1278_RXCONTINUOUS) loop();
+    missed = Radio.RxMissed;
+    end = HostUs + Radio.TimeOnAir(f1.size()) + 200000;
+    Radio.Air(HostUs, (const uint8_t *)f1.data(), f1.size(), -95, 6);
+    Radio.Air(end, (const uint8_t *)f2.data(), f2.size(), -90, 6);
+    end += Radio.TimeOnAir(f2.size()) + 1000;
+    while(HostUs < end) loop();
+    return Radio.RxMissed == missed;
+}
+
+static void AirAX25(const char *text) {
+    uint8_t buf[255];
+    uint8_t len = EncodeAX25((char *)text, buf);
+
+    Radio.Air(HostUs, buf, len, -95, 6);
+}
+
+/* FRAME SENT SINCE INDEX, TEXT FORM (AX.25 DECODED) */
+static std::string Sent(size_t i) {
+    char out[512];
+    std::vector<uint8_t> &d = Radio.Sent[i].data;
+
+    if(d.size() > 3 && d[0] == '<') return std::string(d.begin() + 3, d.end());
+    DecodeAX25(d.data(), d.size(), out);
+    return out;
+}
+
+static int SentCount(size_t from, const char *text) {
+    int n = 0;
+
+    for(size_t i=from; i<Radio.Sent.size(); i++) if(Sent(i).find(text) != std::string::npos) n++;
+    return n;
+}
+
+int main() {
+    size_t n;
+    char text[256];
+    int k;
+
+    HostAnalog[BATT_VOLT] = 900;        // 4.0 volts
+    MCUSR = bit(PORF);
+    setup();
+    Run(10);
+
+    /* WIDEN-N, ONE HOP USED */
+    n = Radio.Sent.size();
+    AirOE("N0CALL-9>APRS,WIDE2-2:>hello");
+    Run(15);
+    CHECK(SentCount(n, "N0CALL-9>APRS,VE2YAG-4*,WIDE2-1:>hello") == 1);
+
+    /* DUPLICATE IS DROPPED */
+    n = Radio.Sent.size();
+    AirOE("N0CALL-9>APRS,WIDE2-2:>hello");
+    Run(15);
+    CHECK(SentCount(n, ">hello") == 0);
+
+    /* AX.25 FRAME STAY AX.25 */
+    n = Radio.Sent.size();
+    AirAX25("N0CALL-7>APRS,WIDE1-1:>binary");
+    Run(15);
+    CHECK(SentCount(n, "N0CALL-7>APRS,VE2YAG-4*:>binary") == 1);
+    CHECK(n < Radio.Sent.size() && Radio.Sent.back().data[0] != '<');
+
+    /* MESSAGE ACK AND STATUS QUERY */
+    n = Radio.Sent.size();
+    AirOE("N0CALL>APRS::VE2YAG-4 :?APRSS{12");
+    Run(30);
+    CHECK(SentCount(n, ":N0CALL   :ack12") == 1);
+    CHECK(SentCount(n, "VE2YAG-4>APZDG2-1") >= 1);
+
+    /* FIXED ALIAS, SSID 0 */
+    n = Radio.Sent.size();
+    AirOE("N0CALL-5>APRS,QC:>alias");
+    Run(15);
+    CHECK(SentCount(n, "N0CALL-5>APRS,VE2YAG-4*:>alias") == 1);
+
+    /* FULL PATH (8 ENTRY), NO ROOM TO INSERT OUR CALL: DEST SSID AND WIDE
+       NOT DIGIPEATED, ONE LESS ENTRY IS */
+    n = Radio.Sent.size();
+    AirAX25("N0CALL-6>APRS-1,D1,D2,D3,D4,D5,D6,D7,D8*:>full ssid");
+    Run(15);
+    AirOE("N0CALL-6>APRS-1,D1,D2,D3,D4,D5,D6,D7,D8*:>full oe ssid");
+    Run(15);
+    AirAX25("N0CALL-6>APRS,D1,D2,D3,D4,D5,D6,D7*,WIDE2-2:>full wide");
+    Run(15);
+    AirOE("N0CALL-6>APRS,D1,D2,D3,D4,D5,D6,D7*,WIDE2-2:>full oe wide");
+    Run(15);
+    CHECK(SentCount(n, ">full") == 0);
+    AirOE("N0CALL-6>APRS,D1,D2,D3,D4,D5,D6*,WIDE2-2:>seven");
+    Run(15);
+    CHECK(SentCount(n, "D6,VE2YAG-4*,WIDE2-1:>seven") == 1);
+
+    /* CONFIG READ, ACK SENT BEFORE REPLY (ONE TX FRAME ON ATMEGA168) */
+    n = Radio.Sent.size();
+    AirOE("N0CALL>APRS::VE2YAG-4 :CFG WN{13");
+    Run(30);
+    CHECK(SentCount(n, ":N0CALL   :ack13") == 1);
+    CHECK(SentCount(n, ":N0CALL   :CFG WN=3") == 1);
+    CHECK(Radio.Sent.size() >= n + 2 && Sent(n).find("ack13") != std::string::npos);
+
+    /* CONFIG SET WITH SEQ OVER 16 BITS, REPLAY REJECTED, 32 BITS MAX REFUSED */
+    for(k=0; k<3; k++) {
+        const char *cmd = (k < 2) ? "CFG WN=3 70000" : "CFG WN=3 4294967295";
+        n = Radio.Sent.size();
+        sprintf(text, "N0CALL>APRS::VE2YAG-4 :%s %08X", cmd, ConfigMac(cmd, strlen(cmd)));
+        AirRx(text);
+        Run(30);
+        CHECK(SentCount(n, (k == 0) ? ":N0CALL   :CFG WN=3 OK" : ":N0CALL   :CFG ERR AUTH") == 1);
+    }
+    n = Radio.Sent.size();
+    AirRx("N0CALL>APRS::VE2YAG-4 :CFG");
+    Run(30);
+    CHECK(SentCount(n, ":N0CALL   :CFG N=70000 ") == 1);
+
+    /* NOTHING RECEIVED WHILE TRANSMITTING IS LOST SILENTLY, REST IS */
+    CHECK(Radio.RxOk == 15);
+
+    /* HEARD LIST: DIRECT WITHOUT PATH, SIGNAL FROM DIRECT COPY ONLY, DIRECT AGE OUT */
+    #if HEARD_MAX > 0
+    uint16_t rejected = lora.getRxRejected();
+    Run(HEARD_TIMEOUT);
+    AirOE("N0CALL-3>APRS:>direct", -97);
+    Run(10);
+    AirAX25("N0CALL-5>APRS:>direct");
+    Run(10);
+    CHECK(lora.getRxRejected() == rejected + 2);      // Path-less, dropped in filter
+    AirOE("N0CALL-3>APRS,OTHER*:>via", -60);
+    Run(10);
+    n = Radio.Sent.size();
+    AirOE("N0CALL>APRS::VE2YAG-4 :?APRSD");
+    Run(20);
+    CHECK(SentCount(n, "N0CALL-3(-97/6)") == 1);
+    CHECK(SentCount(n, "N0CALL-5(-95/6)") == 1);
+    Run(HEARD_TIMEOUT);
+    AirOE("N0CALL-3>APRS,OTHER*:>via again", -60);
+    Run(10);
+    n = Radio.Sent.size();
+    AirOE("N0CALL>APRS::VE2YAG-4 :?APRSD");
+    Run(20);
+    CHECK(SentCount(n, "Directs=") == 1 && SentCount(n, "N0CALL-3") == 0);
+    #endif
+
+    /* SOURCE RATE: FLOODER THROTTLED, NOT EVICTED BY OTHER SOURCE. BUCKET
+       LEFT AT FIRST THROTTLED FRAME IS UNDER ITS COST, PLUS REFILL SINCE */
+    #if SRC_RATE_MAX > 0
+    int sent = 0;
+    uint32_t cost, again;
+    uint64_t t = 0;
+    n = Radio.Sent.size();
+    for(k=0; k<20; k++) {
+        size_t m = Radio.Sent.size();
+        sprintf(text, "FLOOD>APRS,WIDE1-1:>flood %02d ....................", k);
+        t = HostUs;
+        AirRx(text);
+        Run(15);
+        if(SentCount(m, text + 20) == 0) break;
+    }
+    cost = lora.timeOnAir(3 + strlen(text) + 10);      // With VE2YAG-4* inserted
+    sent = SentCount(n, "FLOOD>APRS,VE2YAG-4*");
+    CHECK(k < 20 && sent == k && sent >= 3);
+    for(k=1; k<=SRC_RATE_MAX; k++) {
+        sprintf(text, "OTHER-%d>APRS,WIDE1-1:>other", k);
+        AirRx(text);
+        Run(1);
+    }
+    n = Radio.Sent.size();
+    sprintf(text, "FLOOD>APRS,WIDE1-1:>flood again %0200d", 0);
+    again = lora.timeOnAir(3 + strlen(text));
+    CHECK(cost + (HostUs - t + 15 * HOST_SEC) / HOST_SEC * SRC_RATE_MS / SRC_RATE_PERIOD < again);
+    CHECK(again < SRC_RATE_NEW);                        // Would pass if evicted
+    AirRx(text);
+    Run(15);
+    CHECK(SentCount(n, "flood again") == 0);
+    #endif
+
+    /* VISCOUS: DIGIPEAT HELD, CANCELLED WHEN ANOTHER DIGI REPEAT IT FIRST 
+       (PAIR AIRED AGAIN IF ONE IS MISSED). STATUS COUNT HELD/CANCELLED/SENT,
+       EACH HELD FRAME IS CANCELLED OR SENT */
+    #if VISCOUS_DELAY > 0
+    unsigned int held[2], cancel[2], vsent[2];
+    char copy[64];
+    uint64_t rx;
+    for(int q=0; q<2; q++) {
+        if(q) {
+            n = Radio.Sent.size();
+            rx = AirRx("N0CALL-8>APRS,WIDE2-2:>held");
+            Run(15);
+            CHECK(SentCount(n, "N0CALL-8>APRS,VE2YAG-4*,WIDE2-1:>held") == 1);
+            for(size_t i=n; i<Radio.Sent.size(); i++) {
+                if(Sent(i).find(">held") != std::string::npos) CHECK(Radio.Sent[i].start >= rx + (VISCOUS_DELAY - 1) * HOST_SEC);
+            }
+
+            for(k=0; k<5; k++) {
+                sprintf(text, "N0CALL-8>APRS,WIDE2-2:>cancel %d", k);
+                sprintf(copy, "N0CALL-8>APRS,OTHER*,WIDE2-1:>cancel %d", k);
+                n = Radio.Sent.size();
+                if(AirPair(text, copy)) break;
+                Run(15);
+            }
+            Run(15);
+            CHECK(k < 5 && SentCount(n, text + 22) == 0);
+        }
+        Run(BCN_QUERY_MIN);
+        n = Radio.Sent.size();
+        AirRx("N0CALL>APRS::VE2YAG-4 :?APRSS");
+        Run(30);
+        held[q] = cancel[q] = vsent[q] = 0;
+        for(size_t i=n; i<Radio.Sent.size(); i++) {
+            std::string st = Sent(i);
+            if(st.find(">APZDG2-1:>") != std::string::npos && st.find(" V") != std::string::npos) {
+                sscanf(st.c_str() + st.find(" V"), " V%u/%u/%u", &held[q], &cancel[q], &vsent[q]);
+            }
+        }
+    }
+    CHECK(cancel[1] - cancel[0] >= 1 && vsent[1] - vsent[0] >= 1);
+    CHECK(held[1] - held[0] == (cancel[1] - cancel[0]) + (vsent[1] - vsent[0]));
+    #endif
+
+    /* AIRTIME BUDGET USED IN SLOT ABOUT TO ROLL OFF: DIGIPEAT DROPPED, HEARD
+       REPLY HELD UNTIL SLOT ROTATE THEN SENT. STATUS COUNT DROP (X) */
+    unsigned int drop[2];
+    for(int q=0; q<2; q++) {
+        if(q) {
+            for(k=0; k<6; k++) AirtimeSlot[k] = 0;
+            AirtimeSlot[(AirtimeIndex + 1) % 6] = AIRTIME_BUDGET * 100;
+            AirtimeTimer = wdt_clk + 60;
+            n = Radio.Sent.size();
+            AirRx("N0CALL-6>APRS,WIDE2-2:>budget");
+            Run(15);
+            CHECK(SentCount(n, ">budget") == 0);
+            #if HEARD_MAX > 0
+            AirRx("N0CALL>APRS::VE2YAG-4 :?APRSD");
+            Run(15);
+            CHECK(SentCount(n, ":Directs=") == 0);
+            Run(60);
+            CHECK(SentCount(n, ":Directs=") == 1);
+            #endif
+        }
+        Run(BCN_QUERY_MIN);
+        n = Radio.Sent.size();
+        AirRx("N0CALL>APRS::VE2YAG-4 :?APRSS");
+        Run(30);
+        drop[q] = 0;
+        for(size_t i=n; i<Radio.Sent.size(); i++) {
+            std::string st = Sent(i);
+            if(st.find(">APZDG2-1:>") != std::string::npos && st.find(" X") != std::string::npos) {
+                sscanf(st.c_str() + st.find(" X"), " X%u", &drop[q]);
+            }
+        }
+    }
+    CHECK(drop[1] == drop[0] + 1);
+
+    TEST_END();
+}
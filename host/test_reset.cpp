@@ -0,0 +1,95 @@
+/******************************************************************************
+ * Kept state and reset log across reset: setup() is run again with MCUSR of
+ * each reset cause, .noinit variable keep their value like on AVR.
+ *****************************************************************************/
+#include "project.h"
+#include "host.h"
+#include "test.h"
+
+#include <string>
+
+void setup();
+void loop();
+
+static void Run(uint32_t sec) {
+    uint64_t end = HostUs + sec * HOST_SEC;
+
+    while(HostUs < end) loop();
+}
+
+static void AirOE(const char *text) {
+    std::string f = std::string("<\xFF\x01") + text;
+
+    Radio.Air(HostUs, (const uint8_t *)f.data(), f.size(), -95, 6);
+}
+
+static int SentCount(size_t from, const char *text) {
+    int n = 0;
+
+    for(size_t i=from; i<Radio.Sent.size(); i++) {
+        std::string s(Radio.Sent[i].data.begin(), Radio.Sent[i].data.end());
+        if(s.find(text) != std::string::npos) n++;
+    }
+    return n;
+}
+
+/* RESET WITH MCUSR CAUSE, SEALED BEFORE IF SEAL IS SET */
+static void Reset(uint8_t mcusr, char seal) {
+    if(seal) DigiSeal(seal);
+    MCUSR = mcusr;
+    setup();
+    Run(5);
+}
+
+/* DIGIPEAT COUNT OF SAME FRAME */
+static int Digipeat() {
+    size_t n = Radio.Sent.size();
+
+    AirOE("N0CALL-9>APRS,WIDE2-2:>kept");
+    Run(15);
+    return SentCount(n, "VE2YAG-4*,WIDE2-1:>kept");
+}
+
+/* STATUS BEACON TEXT ON QUERY (GLOBAL ARE NOT CLEARED BY HOST RESET, WAIT
+   QUERY RATE LIMIT) */
+static std::string Status() {
+    size_t n;
+
+    Run(BCN_QUERY_MIN);
+    n = Radio.Sent.size();
+    AirOE("N0CALL>APRS::VE2YAG-4 :?APRSS");
+    Run(30);
+    for(size_t i=n; i<Radio.Sent.size(); i++) {
+        std::string s(Radio.Sent[i].data.begin(), Radio.Sent[i].data.end());
+        if(s.find(">APZDG2-1:>") != std::string::npos) return s;
+    }
+    return "";
+}
+
+int main() {
+    std::string status;
+
+    HostAnalog[BATT_VOLT] = 900;
+    Reset(bit(PORF), 0);
+    CHECK(Digipeat() == 1);
+
+    /* DAILY REBOOT, DUPLICATE KEPT */
+    Reset(bit(WDRF), 'D');
+    CHECK(Digipeat() == 0);
+    CHECK(Status().find(" B1DP") != std::string::npos);
+
+    /* HANG, LOG KEPT, DUPLICATE NOT RESTORED */
+    CHECK(Digipeat() == 1);
+    Reset(bit(WDRF), 'H');
+    CHECK(Digipeat() == 1);
+    CHECK(Status().find(" B2HDP") != std::string::npos);
+
+    /* EXTERNAL AND UNSEALED WATCHDOG RESET, LOG KEPT, STATE CLEARED */
+    Reset(bit(EXTRF), 0);
+    Reset(bit(WDRF), 0);
+    status = Status();
+    CHECK(status.find(" B4WEHD") != std::string::npos);
+    CHECK(status.find(" R1D0") != std::string::npos);
+
+    TEST_END();
+}
@@ -0,0 +1,80 @@
+/******************************************************************************
+ * Beacon scheduler on quiet channel, 20 hours (under WD_REBOOT_VALUE): own
+ * frame count after 4 and 20 hours, PARM/UNIT/EQNS sent after boot then at
+ * doubling interval, T# merged in position beacon due in BCN_MERGE window,
+ * both position beacon sent with their own comment.
+ *****************************************************************************/
+#include "project.h"
+#include "host.h"
+#include "test.h"
+
+#include <string>
+#include <vector>
+
+void setup();
+void loop();
+
+#define HOURS 20
+
+struct TCount {
+    int frames, pos, pos2, merged, telem, status;
+    std::vector<double> parm, post;
+};
+
+/* OWN FRAME SENT BEFORE HOUR */
+static TCount Count(int hours) {
+    TCount c = TCount();
+
+    for(size_t i=0; i<Radio.Sent.size(); i++) {
+        std::string s(Radio.Sent[i].data.begin(), Radio.Sent[i].data.end());
+        std::string data = s.substr(s.find(':') + 1);
+        double t = Radio.Sent[i].start / 1e6;
+
+        if(t >= hours * 3600) break;
+        c.frames++;
+        if(data[0] == '!') {
+            c.pos++;
+            c.post.push_back(t);
+            if(data.find('|') != std::string::npos) c.merged++;
+            if(data.find(B2_COMMENT) != std::string::npos) c.pos2++;
+        } else if(data[0] == '>') c.status++;
+        else if(data.compare(0, 2, "T#") == 0) c.telem++;
+        else if(data.find(":PARM.") != std::string::npos) c.parm.push_back(t);
+    }
+    printf("%2d hours: %3d frame, %2d position (%d beacon 2, %d with T# merged), %2d T#, %2d status, %zu metadata, PARM at",
+           hours, c.frames, c.pos, c.pos2, c.merged, c.telem, c.status, c.parm.size());
+    for(size_t i=0; i<c.parm.size(); i++) printf(" %.0f", c.parm[i]);
+    printf(" s\n");
+    return c;
+}
+
+int main() {
+    TCount c;
+    double interval = BCN_META_MIN;
+
+    HostAnalog[BATT_VOLT] = 900;
+    MCUSR = bit(PORF);
+    setup();
+    while(HostUs < HOURS * 3600 * HOST_SEC) loop();
+
+    c = Count(4);
+    CHECK(c.parm.size() == 3);
+    c = Count(HOURS);
+
+    /* METADATA AFTER BOOT, THEN BCN_META_MIN DOUBLED EACH TIME, FROM END OF
+       PARM/UNIT/EQNS CYCLE */
+    CHECK(c.parm.size() >= 1 && c.parm[0] >= BCN_META_BOOT && c.parm[0] < BCN_META_BOOT + 30);
+    for(size_t i=1; i<c.parm.size(); i++, interval *= 2) {
+        CHECK(c.parm[i] - c.parm[i-1] >= interval && c.parm[i] - c.parm[i-1] < interval + 2 * BCN_META_SPACING + 60);
+    }
+
+    /* SOME T# RIDE IN POSITION BEACON, NO POSITION BEACON CLOSER THAN MERGE WINDOW */
+    CHECK(c.merged > 0 && c.telem > 0);
+    for(size_t i=1; i<c.post.size(); i++) CHECK(c.post[i] - c.post[i-1] > BCN_MERGE);
+
+    /* BEACON 2 NOT LOST IN BEACON 1, AT MOST PUSHED BY MERGE WINDOW */
+    CHECK(c.pos2 >= HOURS * 3600 / (B2_INTERVAL + BCN_JITTER + BCN_MERGE));
+    CHECK(c.pos - c.pos2 >= HOURS * 3600 / (B1_INTERVAL + BCN_JITTER + BCN_MERGE));
+
+    TEST_END();
+}
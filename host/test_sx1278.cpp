@@ -0,0 +1,178 @@
+/******************************************************************************
+ * SX1278 driver against register emulator
+ *
+ * Check TX, RX queue from DIO0 IRQ, RX filter, CAD, sleep/resume and FEI,
+ * then print SPI transaction, byte and bus time of each driver call. Driver
+ * counter must match byte seen by emulator.
+ *****************************************************************************/
+#include "project.h"
+#include "host.h"
+#include "test.h"
+
+#include <avr/sleep.h>
+
+SX1278 drv(SX1278_BW_125_00_KHZ, SX1278_SF_12, SX1278_CR_4_5);
+
+ISR(PCINT2_vect) {
+    drv.dio0Irq();
+}
+
+static uint8_t FilterPass = 1;
+static uint8_t Filter(uint8_t *head, uint8_t n, uint8_t length) {
+    return FilterPass;
+}
+
+/* SPI COST OF LAST CALL, DRIVER COUNTER CHECKED AGAINST EMULATOR */
+static uint32_t SpiCount, SpiBytes;
+static void Start() {
+    drv.clearSpiCount();
+    SpiCount = Radio.SpiCount;
+    SpiBytes = Radio.SpiBytes;
+}
+
+static void Cost(const char *name) {
+    printf("%-22s %5u %6lu %7lu\n", name, drv.getSpiCount(), (unsigned long)drv.getSpiBytes(), (unsigned long)drv.getSpiTime());
+    CHECK(drv.getSpiCount() == Radio.SpiCount - SpiCount);
+    CHECK(drv.getSpiBytes() == Radio.SpiBytes - SpiBytes);
+}
+
+static void WaitDio() {
+    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+    sleep_mode();
+}
+
+static void Frame(uint8_t *buf, uint8_t len, uint8_t seed) {
+    for(uint8_t i=0; i<len; i++) buf[i] = seed + i * 7;
+}
+
+int main() {
+    uint8_t buf[256], out[256], len;
+    uint64_t t;
+
+    sei();
+    printf("%-22s %5s %6s %7s\n", "call", "trans", "bytes", "bus us");
+
+    /* DETECT AND CONFIGURE */
+    Start();
+    CHECK(drv.begin(LORA_CS, LORA_RESET, LORA_DIO) == ERR_NONE);
+    Cost("begin");
+    CHECK(Radio.Reg(SX1278_REG_OP_MODE) == (SX1278_LORA | SX1278_STANDBY));
+    CHECK((Radio.Reg(SX1278_REG_MODEM_CONFIG_2) & 0xF0) == SX1278_SF_12);
+    CHECK(Radio.Reg(SX1278_REG_MODEM_CONFIG_3) & SX1278_LOW_DATA_RATE_OPT_ON);
+    for(len=10; len<250; len+=60) CHECK(drv.timeOnAir(len) == (Radio.TimeOnAir(len) + 999) / 1000);
+
+    Start();
+    drv.config(SX1278_BW_125_00_KHZ, SX1278_SF_12, SX1278_CR_4_5);
+    Cost("config (same value)");
+
+    Start();
+    drv.startReceive();
+    Cost("startReceive");
+    CHECK(Radio.Mode() == SX1278_RXCONTINUOUS);
+
+    /* TRANSMIT, CPU SLEEP UNTIL TX_DONE */
+    Frame(buf, 50, 1);
+    Start();
+    drv.tx(buf, 50);
+    Cost("tx 50 bytes");
+    t = HostUs;
+    while(drv.txBusy()) WaitDio();
+    CHECK(Radio.Sent.size() == 1 && Radio.Sent[0].data.size() == 50);
+    CHECK(Radio.Sent.size() == 1 && memcmp(Radio.Sent[0].data.data(), buf, 50) == 0);
+    CHECK(HostUs - t >= Radio.TimeOnAir(50) && HostUs - t < Radio.TimeOnAir(50) + 1000);
+    CHECK(Radio.Mode() == SX1278_STANDBY);
+
+    /* OP_MODE SHADOW KNOW RADIO IS BACK IN STANDBY */
+    Start();
+    drv.setMode(SX1278_STANDBY);
+    CHECK(drv.getSpiCount() == 0);
+
+    /* RECEIVE, DIO0 IRQ DRAIN FIFO IN RX QUEUE */
+    drv.startReceive();
+    Frame(buf, 60, 2);
+    Radio.Air(HostUs, buf, 60, -90, 7, 2000);
+    Start();
+    HostRun(Radio.TimeOnAir(60) + 1000);
+    Cost("dio0Irq 60 bytes");
+    CHECK(drv.rxPending());
+    Start();
+    CHECK(drv.rxAvailable(out, &len) == ERR_NONE);
+    Cost("rxAvailable (queue)");
+    CHECK(len == 60 && memcmp(out, buf, 60) == 0);
+    CHECK(drv.getLastPacketRSSI() == -90);
+    CHECK(drv.getLastPacketSNR() == 7);
+    CHECK(drv.rxAvailable(out, &len) == ERR_RX_EMPTY);
+
+    /* TWO FRAME QUEUED, READ IN ORDER */
+    Frame(buf, 100, 3);
+    Radio.Air(HostUs, buf, 100);
+    HostRun(Radio.TimeOnAir(100) + 1000);
+    Frame(buf, 30, 4);
+    Radio.Air(HostUs, buf, 30);
+    HostRun(Radio.TimeOnAir(30) + 1000);
+    CHECK(drv.rxAvailable(out, &len) == ERR_NONE && len == 100 && out[1] == 3 + 7);
+    CHECK(drv.rxAvailable(out, &len) == ERR_NONE && len == 30 && out[1] == 4 + 7);
+
+    /* CRC ERROR AND FILTER REJECT STAY OUT OF QUEUE, FILTER READ HEADER ONLY */
+    Radio.Air(HostUs, buf, 30, -100, 5, 0, true);
+    HostRun(Radio.TimeOnAir(30) + 1000);
+    CHECK(!drv.rxPending());
+    drv.setRxFilter(Filter);
+    FilterPass = 0;
+    Frame(buf, 120, 5);
+    Radio.Air(HostUs, buf, 120);
+    Start();
+    HostRun(Radio.TimeOnAir(120) + 1000);
+    Cost("dio0Irq rejected");
+    CHECK(drv.getSpiBytes() < 120);
+    CHECK(!drv.rxPending() && drv.getRxRejected() == 1);
+    FilterPass = 1;
+
+    /* COLLISION, NONE RECEIVED */
+    Radio.Air(HostUs, buf, 40);
+    Radio.Air(HostUs + 500000, buf, 40);
+    HostRun(Radio.TimeOnAir(40) + 600000);
+    CHECK(!drv.rxPending());
+
+    /* CAD, FREE THEN BUSY CHANNEL */
+    Start();
+    drv.cadStart();
+    while(drv.cadBusy()) WaitDio();
+    Cost("cad");
+    CHECK(drv.cadDetected() == 0);
+    CHECK(Radio.Mode() == SX1278_STANDBY);
+    Radio.Air(HostUs, buf, 80);
+    drv.cadStart();
+    while(drv.cadBusy()) WaitDio();
+    CHECK(drv.cadDetected() != 0);
+    HostRun(Radio.TimeOnAir(80));
+
+    /* SLEEP AND WARM RESUME, RESUME FAIL AFTER RADIO POWER LOSS */
+    Start();
+    drv.end();
+    Cost("end");
+    CHECK(Radio.Mode() == SX1278_SLEEP);
+    Start();
+    CHECK(drv.resume() == ERR_NONE);
+    Cost("resume");
+    CHECK(Radio.Mode() == SX1278_RXCONTINUOUS);
+    drv.end();
+    Radio.Reset();
+    CHECK(drv.resume() == ERR_CONFIG_LOST);
+    Start();
+    CHECK(drv.begin(LORA_CS, LORA_RESET, LORA_DIO) == ERR_NONE);
+    Cost("begin (after reset)");
+    drv.startReceive();
+
+    /* FREQUENCY ERROR: FEI * 2^24 / 32 MHz * 125 / 500 */
+    drv.clearFrequencyError();
+    for(uint8_t i=0; i<8; i++) {
+        Radio.Air(HostUs, buf, 20, -100, 5, -4000);
+        HostRun(Radio.TimeOnAir(20) + 1000);
+        drv.rxAvailable(out, &len);
+    }
+    CHECK(drv.getFeiCount() == 8);
+    CHECK(labs(drv.getFrequencyError() - (-524)) <= 1);
+
+    TEST_END();
+}
@@ -0,0 +1,36 @@
+/******************************************************************************
+ * Wake-up from power down over 3 hours on quiet channel. make test also
+ * build it with HOST_TICK1, DigiNextEvent() return now: watchdog stay at
+ * 1 s, like before tickless period.
+ *****************************************************************************/
+#include "project.h"
+#include "host.h"
+#include "test.h"
+
+void setup();
+void loop();
+
+#define HOURS 3
+
+#ifdef HOST_TICK1
+#define MODE "1 s watchdog"
+#else
+#define MODE "tickless"
+#endif
+
+int main() {
+    HostAnalog[BATT_VOLT] = 900;
+    MCUSR = bit(PORF);
+    setup();
+    while(HostUs < HOURS * 3600 * HOST_SEC) loop();
+
+    printf("%s: %u wake-up in %d hours, %zu frame sent, %.1f%% of time in power down\n",
+           MODE, HostWake, HOURS, Radio.Sent.size(), HostSleepUs * 100.0 / HostUs);
+    #ifdef HOST_TICK1
+    CHECK(HostWake >= HOURS * 3600);
+    #else
+    CHECK(HostWake < HOURS * 3600 / 4);
+    #endif
+
+    TEST_END();
+}
@@ -5,6 +5,7 @@
 #include "sx1278.h"
 #include "watchdog.h"
 #include "ax25_util.h"
+#include "config.h"
 
 /*
  * When using L as primary table symbol, here symbol ID icon:
@@ -36,9 +37,24 @@
 #define LORA_POWER 20     // Power of radio (dbm)
 #define PPM_ERR lround(0.95 * (FREQ_ERR/FREQ))  // 25khz offset, 0.95*ppm = 25Khz / 433.3 = 57.65 * 0.95 = 55
 
+/* AUTOMATIC FREQUENCY CORRECTION, FROM FEI OF RECEIVED PACKET */
+#define AFC_ENABLE    1
+#define AFC_INTERVAL  600     // Check frequency error each 10 minutes
+#define AFC_MIN_PKT   5       // Minimum received packet to apply correction
+#define AFC_DEADBAND  250     // Hz, don't correct smaller error
+#define AFC_MAX       10000   // Hz, maximum correction from FREQ_ERR
+
 /* RADIO CHANNEL COLLISION */
-#define CHANNEL_SLOTTIME 100  /* 100ms slottime */
-#define CHANNEL_PERSIST 63    /* 25% persistance */
+#define CHANNEL_SLOTTIME 100  /* 100ms slottime (not adaptive) */
+#define CHANNEL_PERSIST 63    /* 25% persistance (not adaptive) */
+#define CHANNEL_ADAPTIVE 1    /* Persistance and slottime follow channel load */
+#define CHANNEL_LOAD_INTERVAL 60  /* Sec, channel busy ratio sample */
+#define CHANNEL_LOAD_FULL 50  /* % busy giving minimum persistance and maximum slottime */
+#define CHANNEL_PERSIST_MIN 32
+#define CHANNEL_PERSIST_MAX 191   /* Quiet channel, default of remote config PS */
+#define CHANNEL_SLOTTIME_MIN 50   /* Quiet channel, default of remote config SL */
+#define CHANNEL_SLOTTIME_MAX 300
+#define CHANNEL_CAD_ENABLE 1  /* Sense channel with Lora CAD, CPU sleep during detection (0 = signal detect bit only) */
 
 /* DIGIPEATER CONFIG */
 #define OE_TYPE_PACKET_ENABLE 1		// Enable ASCII and binary dual mode 
@@ -46,22 +62,94 @@
 #define BCN_DEST "APZDG2-1"		// -1 -2 or -3 for SSID digipeating else:
 #define BCN_PATH ""				// Set to "" to disable,  and "WIDE2-2" for std path
 //#define BCN_POSITION PSTR("!4100.00NL07000.00Wa") // Put your position here
+#define BCN_COMPRESSED 0		// Base 91 position, telemetry in beacon comment instead of T# frame
 #define B1_COMMENT PSTR("433.775 MHz 20dbm B125 SF12 CR45")
 #define B2_COMMENT PSTR("Lora digi V2.1") 
 #define B1_INTERVAL    1800 
 #define B2_INTERVAL    1550
 #define B3_INTERVAL    1750
 #define TELEM_INTERVAL 950
+#define BCN_JITTER     60     // Sec, random +/- added to each interval
+#define BCN_MERGE      120    // Sec, position beacon and telemetry due in this window are sent in one frame
+#define BCN_QUERY_MIN  300    // Sec, minimum between beacon triggered by ?APRS? or ?APRSS query
+#define BCN_QUERY_DELAY 15    // Sec, random delay of query response
+#define BCN_META_BOOT  120    // Sec, PARM/UNIT/EQNS sent after boot
+#define BCN_META_SPACING 30   // Sec, between PARM, UNIT and EQNS
+#define BCN_META_MIN   3600   // Sec, first metadata interval, doubled each time
+#define BCN_META_MAX   86400  // Sec, maximum metadata interval
 #define WIDEN_MAX      3
+#define TRACEN_MAX     3      // TRACEn-N alias (0 to disable)
+#define DIGI_ALIAS     "QC"   // Regional alias, digipeated even further down path (comment to disable)
+
+/* REMOTE CONFIG BY APRS MESSAGE (CFG COMMAND, SEE README), VALUE SAVED IN EEPROM. 
+   VALUE ABOVE ARE DEFAULT: INTERVAL, WIDEN_MAX, LORA_POWER, PERSIST, SLOTTIME, 
+   DUP_DELAY AND CHANNEL_LOAD_FULL */
+//#define CFG_KEY "0123456789ABCDEF"  // Secret key, exactly 16 caracters (comment to allow read only)
+
+/* AIRTIME BUDGET, ROLLING HOUR */
+#define AIRTIME_BUDGET   360  // Max transmit time in sec per hour (10% duty cycle)
+#define AIRTIME_LOW_PCT  75   // Beacon and telemetry deferred above this % of budget
+#define AIRTIME_DEFER    60   // Delay in sec before retrying a deferred beacon
+
+/* HEARD STATION TABLE (?APRSD QUERY) */
+#if defined(__AVR_ATmega168__) || defined(__AVR_ATmega168P__)
+#define HEARD_MAX      0      // Not enough RAM on 1KB part
+#else
+#define HEARD_MAX      8      // Station keeped in table (0 to disable)
+#endif
+#define HEARD_TIMEOUT  1800   // Station heard direct in last 30 min are listed in ?APRSD reply
 
 /* HARDWARE SENSOR CONFIG */
 #define DS_ENABLE           1
+#if defined(__AVR_ATmega168__) || defined(__AVR_ATmega168P__)
+#define BMP180_ENABLE       0     // Wire library buffers (about 190 bytes) don't fit on 1KB part
+#else
 #define BMP180_ENABLE       1
+#endif
 #define VOLT_ENABLE         1
 
 /* FRAME DUPLICATE TABLE CONFIG */
-#define DUP_DELAY 40          /* Delay in sec to keep frame in memory */
-#define DUP_MAXFRAME 5        /* Maximum duplicate frame memory */
+#define DUP_DELAY 40          /* Delay in sec to keep frame in memory (max 90) */
+#if defined(__AVR_ATmega168__) || defined(__AVR_ATmega168P__)
+#define DUP_MAXFRAME 8        /* Maximum duplicate frame memory, power of 2 (3 bytes each) */
+#else
+#define DUP_MAXFRAME 32
+#endif
+#define DUP_PROBE 4           /* Slot checked from hash position */
+
+/* FRAME BUFFER POOL (FRAME_SIZE + 13 BYTES EACH), CHECKED AGAINST RAM SIZE AT COMPILE TIME.
+   ATMEGA168 BUDGET: FRAME 2*133 + SX1278 176 (RX QUEUE 112) + KEEP 73 + RESET LOG 8 = 523 BYTES,
+   KEEP AND RESET LOG ARE IN .NOINIT, LAST BEFORE FREE RAM AND STACK. RESERVE IS SUM OF WHAT IS
+   OUTSIDE BUDGET (ESTIMATE), STATUS BEACON F GIVE LEAST FREE STACK SINCE BOOT (PAINTED RAM):
+   -STATIC ABOUT 260: TIMER AND STATE OF DIGI.CPP 85, CONFIG 24, WATCHDOG 15, SENSOR AND 
+    TELEMETRY 55, AX25 16, ARDUINO CORE 10, STRING IN RAM (CALL, DEST) 60
+   -STACK ABOUT 220: LOOP TO RULES TO SPRINTF_P 140, DIO0 ISR WITH 34 BYTES HEADER 80 */
+#if defined(__AVR_ATmega168__) || defined(__AVR_ATmega168P__)
+#define FRAME_POOL   2        /* One RX and one TX/queued frame */
+#define FRAME_SIZE   120      /* RX queue take frame up to 109 bytes, plus our call inserted */
+#define RAM_RESERVE  480      /* Static outside budget and stack, see above (1003 of 1024 bytes) */
+#else
+#define FRAME_POOL   3
+#define FRAME_SIZE   255      /* Max Lora payload */
+#define RAM_RESERVE  384
+#endif
+
+/* TRANSMIT QUEUE, FRAME DROPPED IF NOT SENT IN TIME */
+#define TXQ_DIGI_MAXAGE 10    /* Sec, digipeat and ack (keep well under DUP_DELAY) */
+#define TXQ_MAXAGE      120   /* Sec, query reply, beacon and telemetry */
+
+/* VISCOUS DIGIPEATING, DIGIPEAT HELD AND DROPPED IF ANOTHER DIGI REPEAT IT FIRST */
+#define VISCOUS_DELAY   0     /* Sec to hold frame (0 = disable, 5 typical) */
+
+/* PER SOURCE AIRTIME LIMIT, TOKEN BUCKET IN MS OF TIME ON AIR */
+#if defined(__AVR_ATmega168__) || defined(__AVR_ATmega168P__)
+#define SRC_RATE_MAX    0     /* Not enough RAM on 1KB part */
+#else
+#define SRC_RATE_MAX    4     /* Source keeped in table (0 to disable) */
+#endif
+#define SRC_RATE_MS     30000 /* Bucket size, max 65535 (about 9 frames of 80 bytes at SF12) */
+#define SRC_RATE_PERIOD 600   /* Sec to refill empty bucket (5% of channel per source) */
+#define SRC_RATE_NEW    10000 /* Bucket of new source, under SRC_RATE_MS (evicted flooder don't come back full) */
 
 /* PIN DEFINITION */
 #define RXD_GPS    0  // UBlox GPS (Only with tracker)
@@ -20,6 +20,84 @@ SX1278::SX1278(uint8_t bw, uint8_t sf, uint8_t cr) {
     _sf = sf;
     _cr = cr;
     _mode = SX1278_STANDBY;
+    _shadowValid = 0;
+}
+
+/******************************************************************************
+ * Register shadow copy
+ *
+ * Configuration register are only changed by this driver, so last value 
+ * written is keeped in RAM. setRegValue() don't need to read them back and 
+ * writeRegister() skip write when value don't change. Status, FIFO and IRQ 
+ * register are never cached. Return 0xFF if register is not cached.
+ *****************************************************************************/
+uint8_t SX1278 :: shadowSlot(uint8_t reg) {
+    switch(reg) {
+        case SX1278_REG_OP_MODE:              return 0;
+        case SX1278_REG_FRF_MSB:              return 1;
+        case SX1278_REG_FRF_MID:              return 2;
+        case SX1278_REG_FRF_LSB:              return 3;
+        case SX1278_REG_PA_CONFIG:            return 4;
+        case SX1278_REG_OCP:                  return 5;
+        case SX1278_REG_LNA:                  return 6;
+        case SX1278_REG_FIFO_TX_BASE_ADDR:    return 7;
+        case SX1278_REG_FIFO_RX_BASE_ADDR:    return 8;
+        case SX1278_REG_MODEM_CONFIG_1:       return 9;
+        case SX1278_REG_MODEM_CONFIG_2:       return 10;
+        case SX1278_REG_PREAMBLE_MSB:         return 11;
+        case SX1278_REG_PREAMBLE_LSB:         return 12;
+        case SX1278_REG_HOP_PERIOD:           return 13;
+        case SX1278_REG_MODEM_CONFIG_3:       return 14;
+        case SX1278_REG_PPMCORRECTION:        return 15;
+        case SX1278_REG_DETECT_OPTIMIZE:      return 16;
+        case SX1278_REG_DETECTION_THRESHOLD:  return 17;
+        case SX1278_REG_SYNC_WORD:            return 18;
+        case SX1278_REG_DIO_MAPPING_1:        return 19;
+        case SX1278_REG_PA_DAC:               return 20;
+    }
+    return 0xFF;
+}
+
+/* RADIO CHANGE MODE BY ITSELF AFTER TX OR CAD, UPDATE SHADOW WITHOUT SPI ACCESS */
+void SX1278 :: shadowMode(uint8_t mode) {
+    _mode = mode;
+    if(_shadowValid & 1) _shadow[0] = (_shadow[0] & 0xF8) | mode;
+}
+
+/******************************************************************************
+ * SPI cost accounting
+ *
+ * Every SPI access go through readRegister, readRegisterBurst, writeRegister 
+ * and writeRegisterBurst. They count transaction and byte clocked (including
+ * dummy byte after CS), so cost of any driver call (tx, rxAvailable, 
+ * InitReceiver, config...) is read by clearing before and reading after.
+ * Counter are updated inside SPI transaction, interrupt are off there when
+ * dio0Irq use SPI (usingInterrupt), no increment lost between loop and ISR.
+ *****************************************************************************/
+uint16_t SX1278 :: getSpiCount(void) {
+    noInterrupts();
+    uint16_t count = _spiCount;
+    interrupts();
+    return count;
+}
+
+uint32_t SX1278 :: getSpiBytes(void) {
+    noInterrupts();
+    uint32_t bytes = _spiBytes;
+    interrupts();
+    return bytes;
+}
+
+/* BUS TIME ONLY, 8 CLOCK PER BYTE AT LORA_SCLK */
+uint32_t SX1278 :: getSpiTime(void) {
+    return getSpiBytes() * 8 / (LORA_SCLK / 1000000L);
+}
+
+void SX1278 :: clearSpiCount(void) {
+    noInterrupts();
+    _spiCount = 0;
+    _spiBytes = 0;
+    interrupts();
 }
 
 uint8_t SX1278 :: getRegValue(uint8_t reg, uint8_t msb, uint8_t lsb) {
@@ -30,8 +108,20 @@ uint8_t SX1278 :: getRegValue(uint8_t reg, uint8_t msb, uint8_t lsb) {
 }
 
 uint8_t SX1278 :: setRegValue(uint8_t reg, uint8_t value, uint8_t msb, uint8_t lsb) {
+    uint8_t currentValue;
     if((msb > 7) || (lsb > 7) || (lsb > msb)) return(ERR_INVALID_BIT_RANGE);
-    uint8_t currentValue = readRegister(reg);
+
+    /* READ CURRENT VALUE FROM SHADOW IF AVAILABLE */
+    uint8_t slot = shadowSlot(reg);
+    if(slot != 0xFF && (_shadowValid & (1UL << slot))) {
+        currentValue = _shadow[slot];
+    } else {
+        currentValue = readRegister(reg);
+        if(slot != 0xFF) {
+            _shadow[slot] = currentValue;
+            _shadowValid |= (1UL << slot);
+        }
+    }
     uint8_t newValue = currentValue & ((0b11111111 << (msb + 1)) & (0b11111111 >> (8 - lsb)));
     writeRegister(reg, newValue | value);
     return(ERR_NONE);
@@ -39,6 +129,8 @@ uint8_t SX1278 :: setRegValue(uint8_t reg, uint8_t value, uint8_t msb, uint8_t l
 
 uint8_t SX1278 :: readRegister(uint8_t reg) {
   SPI.beginTransaction(SPISettings(LORA_SCLK, MSBFIRST, SPI_MODE0));
+    _spiCount++;
+    _spiBytes += 3;
     digitalWrite(_cs, LOW);
     SPI.transfer(reg | SPI_READ);
     uint8_t result = SPI.transfer(0xFF);
@@ -49,9 +141,9 @@ uint8_t SX1278 :: readRegister(uint8_t reg) {
 }
 
 uint8_t SX1278 :: readRegisterBurst(uint8_t reg, uint8_t numBytes, uint8_t *inBytes) {
-    uint8_t outBytes[256];
-    
   SPI.beginTransaction(SPISettings(LORA_SCLK, MSBFIRST, SPI_MODE0));
+    _spiCount++;
+    _spiBytes += numBytes + 2;
     digitalWrite(_cs, LOW);
     SPI.transfer(reg | SPI_READ);
     for(uint8_t i=0; i<numBytes; i++) inBytes[i] = SPI.transfer(0xFF);
@@ -62,7 +154,18 @@ uint8_t SX1278 :: readRegisterBurst(uint8_t reg, uint8_t numBytes, uint8_t *inBy
 }
 
 void SX1278 :: writeRegister(uint8_t reg, uint8_t data) {
+
+    /* SKIP WRITE IF CONFIG REGISTER ALREADY HOLD THIS VALUE */
+    uint8_t slot = shadowSlot(reg);
+    if(slot != 0xFF) {
+        if((_shadowValid & (1UL << slot)) && _shadow[slot] == data) return;
+        _shadow[slot] = data;
+        _shadowValid |= (1UL << slot);
+    }
+
   SPI.beginTransaction(SPISettings(LORA_SCLK, MSBFIRST, SPI_MODE0));
+    _spiCount++;
+    _spiBytes += 3;
     digitalWrite(_cs, LOW);
     SPI.transfer(reg | SPI_WRITE);
     SPI.transfer(data);
@@ -73,6 +176,8 @@ void SX1278 :: writeRegister(uint8_t reg, uint8_t data) {
 
 void SX1278::writeRegisterBurst(uint8_t reg, uint8_t *data, uint8_t numBytes) {
   SPI.beginTransaction(SPISettings(LORA_SCLK, MSBFIRST, SPI_MODE0));
+    _spiCount++;
+    _spiBytes += numBytes + 2;
     digitalWrite(_cs, LOW);
     SPI.transfer(reg | SPI_WRITE);
     for(uint8_t i=0; i<numBytes; i++) SPI.transfer(data[i]);
@@ -85,13 +190,22 @@ uint8_t SX1278::begin(int8_t cs, int8_t rst, int8_t dio0) {
   _cs = cs;
   _reset = rst;
   _dio0 = dio0;
+  _mode = SX1278_SLEEP;     // Keep DIO0 interrupt away from FIFO until receiver is set
+  _shadowValid = 0;         // Register return to default value on reset
   
   /* INIT SPI PORT AND I/O PORT */
     SPI.begin();
     pinMode(_cs, OUTPUT);        
-    if(_dio0 != -1) pinMode(_dio0, INPUT);
     digitalWrite(_cs, HIGH);
 
+    /* DIO0 PIN CHANGE INTERRUPT DRAIN FIFO, PROTECT SPI TRANSACTION FROM IT */
+    if(_dio0 != -1) {
+        pinMode(_dio0, INPUT);
+        SPI.usingInterrupt(255);
+        *digitalPinToPCMSK(_dio0) |= bit(digitalPinToPCMSKbit(_dio0));
+        *digitalPinToPCICR(_dio0) |= bit(digitalPinToPCICRbit(_dio0));
+    }
+
     /* HARDWARE RESET MODULE */
     if(_reset != -1) {
         pinMode(_reset, OUTPUT);
@@ -125,6 +239,26 @@ void SX1278::end(void) {
     setMode(SX1278_SLEEP);
 }
 
+/******************************************************************************
+ * resume()
+ *
+ * Warm restart after end(). Radio keep register in SLEEP mode, so if chip,
+ * LoRa mode and frequency are still there, go straight to RX continuous.
+ * Return ERR_CONFIG_LOST (or ERR_CHIP_NOT_FOUND) if begin() is needed.
+ *****************************************************************************/
+uint8_t SX1278::resume(void) {
+    uint8_t frf[3];
+    uint32_t expected = ((uint64_t)_frequency * 524288L) / 32000000L;
+
+    if(readRegister(SX1278_REG_VERSION) != 0x12) return(ERR_CHIP_NOT_FOUND);
+    if(!(readRegister(SX1278_REG_OP_MODE) & SX1278_LORA)) return(ERR_CONFIG_LOST);
+    readRegisterBurst(SX1278_REG_FRF_MSB, 3, frf);
+    if((((uint32_t)frf[0] << 16) | ((uint16_t)frf[1] << 8) | frf[2]) != expected) return(ERR_CONFIG_LOST);
+
+    InitReceiver();
+    return(ERR_NONE);
+}
+
 uint8_t SX1278::tx(uint8_t*data, uint8_t length) {
     setMode(SX1278_STANDBY);
 
@@ -135,8 +269,7 @@ uint8_t SX1278::tx(uint8_t*data, uint8_t length) {
     writeRegister(SX1278_REG_FIFO_TX_BASE_ADDR, SX1278_FIFO_TX_BASE_ADDR_MAX);
     writeRegister(SX1278_REG_FIFO_ADDR_PTR, SX1278_FIFO_TX_BASE_ADDR_MAX);  
     writeRegisterBurst(SX1278_REG_FIFO, data, length);
-    setMode(SX1278_TX);
-    delay(2);       // Set DIO0 rise to HIGH before check txBusy
+    setMode(SX1278_TX);     // DIO0 rise on TX_DONE, poll txBusy() or sleep until pin change
 
     return(ERR_NONE);
 }
@@ -145,11 +278,13 @@ uint8_t SX1278::txBusy() {
   if(_dio0 != -1) {
     if(digitalRead(_dio0) == HIGH) {
       clearIRQFlags();
+      shadowMode(SX1278_STANDBY);   // Radio return to standby after TX_DONE
       return 0;   
     }
   } else {
     if(readRegister(SX1278_REG_IRQ_FLAGS) & SX1278_CLEAR_IRQ_FLAG_TX_DONE) {
       clearIRQFlags();
+      shadowMode(SX1278_STANDBY);
       return 0;   
     }
   }
@@ -167,18 +302,118 @@ uint8_t SX1278::rxBusy(void) {
     return 0;
 }
 
+void SX1278::startReceive(void) {
+    if(_mode != SX1278_RXCONTINUOUS) InitReceiver(); 
+}
+
+/******************************************************************************
+ * cadStart() / cadBusy()
+ *
+ * Start Channel Activity Detection, DIO0 rise on CadDone. CPU can sleep
+ * until DIO0 interrupt, then cadBusy() return 0 and cadDetected() tell if 
+ * a Lora preamble was found. Radio return to standby after CAD.
+ *****************************************************************************/
+uint8_t SX1278::cadStart(void) {
+    setMode(SX1278_STANDBY);
+    setRegValue(SX1278_REG_DIO_MAPPING_1, SX1278_DIO0_CAD_DONE | SX1278_DIO1_CAD_DETECTED, 7, 4);
+    clearIRQFlags();
+    _cadDetected = 0;
+    setMode(SX1278_CAD);
+    return(ERR_NONE);
+}
+
+uint8_t SX1278::cadBusy(void) {
+    uint8_t flags;
+
+  if(_dio0 != -1) {
+    if(digitalRead(_dio0) == LOW) return 1;
+    flags = readRegister(SX1278_REG_IRQ_FLAGS);
+  } else {
+    flags = readRegister(SX1278_REG_IRQ_FLAGS);
+    if(!(flags & SX1278_CLEAR_IRQ_FLAG_CAD_DONE)) return 1;
+  }
+
+    _cadDetected = flags & SX1278_CLEAR_IRQ_FLAG_CAD_DETECTED;
+    clearIRQFlags();
+    shadowMode(SX1278_STANDBY);   // Radio return to standby after CAD
+    return 0;
+}
+
 void SX1278::InitReceiver() {
     setMode(SX1278_STANDBY);
     setRegValue(SX1278_REG_DIO_MAPPING_1, SX1278_DIO0_RX_DONE | SX1278_DIO1_RX_TIMEOUT, 7, 4);
     clearIRQFlags();  
     writeRegister(SX1278_REG_FIFO_RX_BASE_ADDR, SX1278_FIFO_RX_BASE_ADDR_MAX);
     writeRegister(SX1278_REG_FIFO_ADDR_PTR, SX1278_FIFO_RX_BASE_ADDR_MAX);
-    writeRegister(SX1278_REG_RX_NB_BYTES, 0);
     if(_sf == SX1278_SF_6) writeRegister(SX1278_REG_PAYLOAD_LENGTH, _sf6length); // Set fixed length packet when SF6 is selected
     setMode(SX1278_RXCONTINUOUS);
     delay(1);  
 }
 
+/* BURST READ FIFO TO RX QUEUE, IN TWO PART IF QUEUE WRAP AROUND */
+void SX1278::rxqRead(uint8_t count) {
+    uint8_t n = (SX1278_RXQ_SIZE - _rxqHead < count) ? SX1278_RXQ_SIZE - _rxqHead : count;
+    if(n) readRegisterBurst(SX1278_REG_FIFO, n, &_rxq[_rxqHead]);
+    if(n < count) readRegisterBurst(SX1278_REG_FIFO, count - n, _rxq);
+    _rxqHead = (_rxqHead + count) % SX1278_RXQ_SIZE;
+}
+
+/******************************************************************************
+ * dio0Irq()
+ *
+ * Called from DIO0 pin change interrupt. When receiver is running, copy each
+ * good frame from FIFO to RX queue so nothing is lost while main loop is busy
+ * waiting clear channel or reading sensor. Radio stay in RX continuous.
+ *
+ * Only first SX1278_RX_PEEK bytes and signal are read before asking RX 
+ * filter, rest of payload stay in FIFO if frame is rejected.
+ *****************************************************************************/
+void SX1278::dio0Irq(void) {
+    uint8_t flags, length, n;
+    uint8_t head[SX1278_RX_PEEK + 2];
+
+    /* ONLY RX_DONE ARE HANDLED HERE, TX_DONE IS CHECKED BY txBusy() */
+    if(_mode != SX1278_RXCONTINUOUS) return;
+    if(digitalRead(_dio0) == LOW) return;
+
+    flags = readRegister(SX1278_REG_IRQ_FLAGS);
+    if((flags & SX1278_CLEAR_IRQ_FLAG_RX_DONE) && !(flags & SX1278_CLEAR_IRQ_FLAG_PAYLOAD_CRC_ERROR)) {
+        readFei();
+        length = (_sf == SX1278_SF_6) ? _sf6length : readRegister(SX1278_REG_RX_NB_BYTES);
+
+        /* DROP FRAME IF QUEUE IS FULL */
+        if(length == 0 || (uint16_t)length + 3 > SX1278_RXQ_SIZE - _rxqUsed) {
+            _rxDropped++;
+        } else {
+
+            /* READ HEADER ONLY AND ASK FILTER */
+            writeRegister(SX1278_REG_FIFO_ADDR_PTR, readRegister(SX1278_REG_FIFO_RX_CURRENT_ADDR));
+            n = (length < SX1278_RX_PEEK) ? length : SX1278_RX_PEEK;
+            readRegisterBurst(SX1278_REG_FIFO, n, head);
+            readRegisterBurst(SX1278_REG_PKT_SNR_VALUE, 2, head+n);   // SNR and RSSI register follow
+            if(_rxFilter != 0 && _rxFilter(head, n, length) == 0) {
+                _rxRejected++;
+            } else {
+
+                /* QUEUE LENGTH, SNR, RSSI, HEADER AND REST OF PAYLOAD */
+                _rxq[_rxqHead] = length;
+                if(++_rxqHead == SX1278_RXQ_SIZE) _rxqHead = 0;
+                for(uint8_t i=0; i<2; i++) {
+                    _rxq[_rxqHead] = head[n+i];
+                    if(++_rxqHead == SX1278_RXQ_SIZE) _rxqHead = 0;
+                }
+                for(uint8_t i=0; i<n; i++) {
+                    _rxq[_rxqHead] = head[i];
+                    if(++_rxqHead == SX1278_RXQ_SIZE) _rxqHead = 0;
+                }
+                rxqRead(length - n);
+                _rxqUsed += length + 3;
+            }
+        }
+    }
+    clearIRQFlags();
+}
+
 uint8_t SX1278::rxAvailable(uint8_t *data, uint8_t *length) {
     int status;
 
@@ -190,11 +425,31 @@ uint8_t SX1278::rxAvailable(uint8_t *data, uint8_t *length) {
 
     /* CHECK IF PACKET AVAILABLE */
     *length = 0;
+
+    /* INTERRUPT MODE, GET OLDEST FRAME FROM RX QUEUE */
   if(_dio0 != -1) {
-    if(digitalRead(_dio0) == LOW) return(ERR_RX_EMPTY);
-  } else {
-    if(!(readRegister(SX1278_REG_IRQ_FLAGS) & SX1278_CLEAR_IRQ_FLAG_RX_DONE)) return(ERR_RX_EMPTY);
+    noInterrupts();
+    if(_rxqUsed == 0) {
+        interrupts();
+        return(ERR_RX_EMPTY);
+    }
+    *length = _rxq[_rxqTail];
+    if(++_rxqTail == SX1278_RXQ_SIZE) _rxqTail = 0;
+    _lastSnr = _rxq[_rxqTail];
+    if(++_rxqTail == SX1278_RXQ_SIZE) _rxqTail = 0;
+    _lastRssi = _rxq[_rxqTail];
+    if(++_rxqTail == SX1278_RXQ_SIZE) _rxqTail = 0;
+    for(uint8_t i=0; i<*length; i++) {
+        data[i] = _rxq[_rxqTail];
+        if(++_rxqTail == SX1278_RXQ_SIZE) _rxqTail = 0;
+    }
+    _rxqUsed -= *length + 3;
+    interrupts();
+    return(ERR_NONE);
   }
+
+    /* POLLING MODE, READ FIFO DIRECTLY */
+    if(!(readRegister(SX1278_REG_IRQ_FLAGS) & SX1278_CLEAR_IRQ_FLAG_RX_DONE)) return(ERR_RX_EMPTY);
     setMode(SX1278_STANDBY);
 
     /* CHECK PAYLOAD CRC */
@@ -206,7 +461,21 @@ uint8_t SX1278::rxAvailable(uint8_t *data, uint8_t *length) {
     /* READ PACKET */
     uint8_t headerMode = readRegister(SX1278_REG_MODEM_CONFIG_1) & SX1278_HEADER_IMPL_MODE;
     if(headerMode == SX1278_HEADER_EXPL_MODE) *length = readRegister(SX1278_REG_RX_NB_BYTES);
-    readRegisterBurst(SX1278_REG_FIFO, *length, data);
+
+    /* READ HEADER, ASK FILTER BEFORE READING REST OF PAYLOAD */
+    uint8_t n = (*length < SX1278_RX_PEEK) ? *length : SX1278_RX_PEEK;
+    readRegisterBurst(SX1278_REG_FIFO, n, data);
+    readRegisterBurst(SX1278_REG_PKT_SNR_VALUE, 2, &data[n]);
+    _lastSnr = data[n];
+    _lastRssi = data[n+1];
+    if(_rxFilter != 0 && _rxFilter(data, n, *length) == 0) {
+        _rxRejected++;
+        *length = 0;
+        clearIRQFlags();
+        return(ERR_RX_EMPTY);
+    }
+    if(*length > n) readRegisterBurst(SX1278_REG_FIFO, *length - n, &data[n]);
+    readFei();
     clearIRQFlags();
     return(ERR_NONE);
 }
@@ -218,7 +487,7 @@ uint8_t SX1278::setMode(uint8_t mode) {
 }
 
 uint8_t SX1278::getMode() {   
-    _mode = getRegValue(SX1278_REG_OP_MODE, 2, 0);
+    shadowMode(getRegValue(SX1278_REG_OP_MODE, 2, 0));
     return _mode;
 }
 
@@ -308,6 +577,7 @@ uint8_t SX1278::config(uint8_t bw, uint8_t sf, uint8_t cr) {
   if(bw == SX1278_BW_62_50_KHZ && sf > SX1278_SF_9) ldro = SX1278_LOW_DATA_RATE_OPT_ON;
   if(bw == SX1278_BW_125_00_KHZ && sf > SX1278_SF_10) ldro = SX1278_LOW_DATA_RATE_OPT_ON;
   if(bw == SX1278_BW_250_00_KHZ && sf > SX1278_SF_11) ldro = SX1278_LOW_DATA_RATE_OPT_ON;
+  _ldro = (ldro == SX1278_LOW_DATA_RATE_OPT_ON);
     status = setRegValue(SX1278_REG_MODEM_CONFIG_3, SX1278_AGC_AUTO_ON | ldro);
     if(status != ERR_NONE) return(status);
   
@@ -342,8 +612,81 @@ uint8_t SX1278::config(uint8_t bw, uint8_t sf, uint8_t cr) {
     return(ERR_NONE);
 }
 
+/******************************************************************************
+ * timeOnAir(uint8_t length)
+ *
+ * Return time on air in ms of a frame of length bytes, using Semtech formula 
+ * for current bandwidth, spreading factor, coding rate and LDRO. Explicit 
+ * header (implicit for SF6), CRC on, preamble set in config().
+ *****************************************************************************/
+static const uint32_t BandwidthHz[] PROGMEM = { 7800, 10400, 15600, 20800, 31250, 41700, 62500, 125000, 250000, 500000 };
+
+uint32_t SX1278::timeOnAir(uint8_t length) {
+    uint8_t sf = _sf >> 4;
+    uint8_t cr = _cr >> 1;
+    uint8_t ih = (_sf == SX1278_SF_6);
+
+    /* SYMBOL TIME IN us */
+    uint32_t tsym = (1000000UL << sf) / pgm_read_dword(&BandwidthHz[_bw >> 4]);
+
+    /* PAYLOAD SYMBOL: 8 + max(ceil((8PL - 4SF + 28 + 16CRC - 20IH) / 4(SF - 2DE)) * (CR + 4), 0) */
+    int16_t num = 8 * (int16_t)length - 4 * sf + 28 + 16 - 20 * ih;
+    int16_t den = 4 * (sf - 2 * _ldro);
+    uint16_t nsym = 8;
+    if(num > 0) nsym += ((num + den - 1) / den) * (cr + 4);
+
+    /* PREAMBLE IS n + 4.25 SYMBOL */
+    uint32_t us = tsym * (4 * ((SX1278_PREAMBLE_LENGTH_MSB << 8) | SX1278_PREAMBLE_LENGTH_LSB) + 17) / 4;
+    us += tsym * nsym;
+    return (us + 999) / 1000;
+}
+
+/* SIGNAL OF LAST PACKET RETURNED BY rxAvailable() */
 int16_t SX1278::getLastPacketRSSI(void) {
-    return(-164 + (uint16_t)getRegValue(SX1278_REG_PKT_RSSI_VALUE));
+    return(rawRSSI(_lastRssi));
+}
+
+int8_t SX1278::getLastPacketSNR(void) {
+    return(rawSNR(_lastSnr));
+}
+
+/******************************************************************************
+ * Frequency error indication
+ *
+ * readFei() is called after each good packet, FEI register (20 bits signed)
+ * is filtered by exponential average, weight 1/8 for new value (step rounded
+ * to nearest, same bias for positive and negative error). getFrequencyError() convert average in Hz:
+ * Ferr = FEI * 2^24 / Fxtal * BW / 500kHz. Positive when remote station is 
+ * above local receiver frequency.
+ *****************************************************************************/
+void SX1278::readFei(void) {
+    uint8_t reg[3];
+    int32_t fei, step;
+
+    readRegisterBurst(SX1278_REG_FEI_MSB, 3, reg);
+    fei = ((int32_t)(reg[0] & 0x0F) << 16) | ((uint16_t)reg[1] << 8) | reg[2];
+    if(fei & 0x80000) fei -= 0x100000;      // Sign extend 20 bits
+    
+    if(_feiCount == 0) _fei = fei;
+    else {
+        step = fei - _fei;
+        _fei += (step + (step < 0 ? -4 : 4)) / 8;
+    }
+    if(_feiCount < 255) _feiCount++;
+}
+
+int32_t SX1278::getFrequencyError(void) {
+    noInterrupts();
+    int32_t fei = _fei;
+    interrupts();
+    return (float)fei * (16777216.0 / 32000000.0) * pgm_read_dword(&BandwidthHz[_bw >> 4]) / 500000.0;
+}
+
+void SX1278::clearFrequencyError(void) {
+    noInterrupts();
+    _fei = 0;
+    _feiCount = 0;
+    interrupts();
 }
 
 void SX1278::setPpmError(char err) {
@@ -8,6 +8,7 @@
 
 #define ERR_NONE                        0x00
 #define ERR_CHIP_NOT_FOUND              0x01
+#define ERR_CONFIG_LOST                 0x02
 
 #define ERR_PACKET_TOO_LONG             0x10
 
@@ -233,18 +234,46 @@
 #define SX1278_STATUS_SIG_SYNCED                      0b00000010
 #define SX1278_STATUS_RX_ONGOING                      0b00000100
 
+//RX frame queue, filled by DIO0 RX_DONE interrupt. Each frame is stored as [length][snr][rssi][payload]
+#if defined(__AVR_ATmega168__) || defined(__AVR_ATmega168P__)
+#define SX1278_RXQ_SIZE                               112         // Frame up to 109 bytes, larger one are dropped (RAM)
+#else
+#define SX1278_RXQ_SIZE                               384
+#endif
+
+//First bytes read from FIFO and given to RX filter before reading the rest of the frame
+#define SX1278_RX_PEEK                                32
+
+//Number of configuration register keeped in shadow copy (see SX1278::shadowSlot)
+#define SX1278_SHADOW_REGS                            21
+
+//RX filter, return 0 to drop frame. Called from DIO0 interrupt with first bytes of frame,
+//head[size] and head[size+1] are raw SNR and RSSI register of the frame (see rawSNR/rawRSSI)
+typedef uint8_t (*SX1278RxFilter)(uint8_t *head, uint8_t size, uint8_t length);
+
 class SX1278 {
   public:
     SX1278(uint8_t bw, uint8_t sf, uint8_t cr);
     
     uint8_t begin(int8_t cs, int8_t reset, int8_t dio0);
     void    end(void);
+    uint8_t resume(void);
     
     uint8_t tx(uint8_t *data, uint8_t length);
   uint8_t txBusy(void);
 
   uint8_t rxAvailable(uint8_t *data, uint8_t *length);
     uint8_t rxBusy(void); 
+    void    startReceive(void);
+    uint8_t rxPending(void) { return _rxqUsed != 0; }
+    uint8_t getRxDropped(void) { return _rxDropped; }
+    uint16_t getRxRejected(void) { return _rxRejected; }
+    void    setRxFilter(SX1278RxFilter filter) { _rxFilter = filter; }
+    void    dio0Irq(void);      // Call from DIO0 pin change interrupt
+
+    uint8_t cadStart(void);
+    uint8_t cadBusy(void);
+    uint8_t cadDetected(void) { return _cadDetected; }
     
     uint8_t setMode(uint8_t mode);
     void    setFrequency(uint32_t frequency);
@@ -253,13 +282,41 @@ class SX1278 {
     uint8_t getPower() { return _power; }
     uint8_t getMode();
     uint8_t config(uint8_t bw, uint8_t sf, uint8_t cr);
+    uint32_t timeOnAir(uint8_t length);  // Airtime in ms of a frame with current modem config
     int16_t getLastPacketRSSI(void);
+    int8_t  getLastPacketSNR(void);     // SNR in dB
+    static int16_t rawRSSI(uint8_t reg) { return -164 + (uint16_t)reg; }
+    static int8_t  rawSNR(uint8_t reg) { return (int8_t)reg / 4; }
+    int32_t getFrequencyError(void);    // Filtered FEI of received packet in Hz (remote - local)
+    uint8_t getFeiCount(void) { return _feiCount; }
+    void    clearFrequencyError(void);
     void    setPpmError(char err);      // Ferr in Hz / carrier in Mhz
+    uint16_t getSpiCount(void);         // SPI transaction since last clear
+    uint32_t getSpiBytes(void);         // SPI bytes clocked since last clear
+    uint32_t getSpiTime(void);          // SPI bus time in us since last clear
+    void    clearSpiCount(void);
  
   private:
-    uint8_t _bw, _sf, _cr, _power, _mode, _sf6length;
+    uint8_t _bw, _sf, _cr, _power, _sf6length, _ldro;
+    volatile uint8_t _mode;
     int8_t _cs, _reset, _dio0;
     uint32_t _frequency;
+    uint8_t _rxq[SX1278_RXQ_SIZE];
+    volatile uint16_t _rxqHead, _rxqTail, _rxqUsed;
+    volatile uint8_t _rxDropped;
+    volatile uint16_t _rxRejected;
+    SX1278RxFilter _rxFilter;
+    uint8_t _cadDetected;
+    uint8_t _lastSnr, _lastRssi;        // Raw register value of last packet
+    volatile int32_t _fei;              // Filtered raw FEI register value
+    volatile uint8_t _feiCount;
+    void readFei(void);
+    volatile uint16_t _spiCount;
+    volatile uint32_t _spiBytes;
+    uint8_t _shadow[SX1278_SHADOW_REGS];
+    uint32_t _shadowValid;
+    uint8_t shadowSlot(uint8_t reg);
+    void shadowMode(uint8_t mode);
     uint8_t getRegValue(uint8_t reg, uint8_t msb = 7, uint8_t lsb = 0);
     uint8_t setRegValue(uint8_t reg, uint8_t value, uint8_t msb = 7, uint8_t lsb = 0);
     uint8_t readRegisterBurst(uint8_t reg, uint8_t numBytes, uint8_t *inBytes);
@@ -267,6 +324,7 @@ class SX1278 {
     void writeRegister(uint8_t reg, uint8_t data);
     void writeRegisterBurst(uint8_t reg, uint8_t *data, uint8_t numBytes);
     void clearIRQFlags(void);
+    void rxqRead(uint8_t count);
 //    void enableRx(void);
     void InitReceiver();
     void setOCP(uint8_t mA);
@@ -4,37 +4,90 @@
 #include <avr/wdt.h>
 #include <avr/interrupt.h>
 
-/* 1 HZ TICK COUNTER, REPLACING MILLIS() BECAUSE CPU USE POWER DOWN */
+/* SECOND COUNTER, REPLACING MILLIS() BECAUSE CPU USE POWER DOWN */
 volatile uint32_t wdt_clk;
 
+/* SEC BETWEEN IRQ (1, 2, 4 OR 8), LONGEST FITTING BEFORE WDT_WAKE */
+volatile uint8_t wdt_period;
+volatile uint32_t wdt_wake;
+volatile uint32_t wdt_mark;     // millis() at last IRQ
+
 /* CLEAR THIS COUNTER TO TRIG THE WATCHDOG, AFTER 30 SEC, THE BOARD RESET ITSELF */
 volatile uint8_t wdt_flag;
 
+/* MCUSR AT BOOT, BEFORE CLEARED */
+uint8_t wdt_reset_cause;
+
 /******************************************************
  * PCINT2 interrupt vector 
  * (for pin interrup PCINT16-PCINT23)
+ * 
+ * Lora DIO0, drain received frame in RX queue.
  *****************************************************/
 ISR(PCINT2_vect) { 
+    lora.dio0Irq();
 } 
 
 /******************************************************
  * Watchdog IRQ
  * 
- * -Provide 1 Hz clock (wdt_clk)
+ * -Provide 1 sec clock (wdt_clk), incremented by period
  * -Provide 30 sec watchdog if wdt_flag not cleared.
- * -Reset board every 24h
+ * -Reset board every 24h, digi state is sealed to 
+ *  survive reset
+ * -Select next period, up to 8 sec if wdt_wake is far
  ******************************************************/
 ISR(WDT_vect) {
-    wdt_flag++;
-    wdt_clk++;
+    uint8_t p;
+
+    wdt_flag += wdt_period;
+    wdt_clk += wdt_period;
+    wdt_mark = millis();
     if(wdt_flag > 30 || wdt_clk > WD_REBOOT_VALUE) {
+        DigiSeal(wdt_flag > 30 ? 'H' : 'D');
         WDTCSR |= (1<<WDCE) | (1<<WDE);
         WDTCSR = (1<<WDE);        // Enable watchdog reset, timeout 16ms.
         while(1);                 // Wait CPU reset
     } 
+
+    /* NEXT PERIOD, STAY UNDER NEXT DEADLINE */
+    p = 1;
+    if(wdt_wake >= wdt_clk + 8) p = 8;
+    else if(wdt_wake >= wdt_clk + 4) p = 4;
+    else if(wdt_wake >= wdt_clk + 2) p = 2;
+    if(p != wdt_period) {
+        wdt_period = p;
+        WDTCSR |= (1<<WDCE) | (1<<WDE);
+        switch(p) {
+            case 1: WDTCSR = (1<<WDIE) | (1<<WDP2) | (1<<WDP1); break;
+            case 2: WDTCSR = (1<<WDIE) | (1<<WDP2) | (1<<WDP1) | (1<<WDP0); break;
+            case 4: WDTCSR = (1<<WDIE) | (1<<WDP3); break;
+            case 8: WDTCSR = (1<<WDIE) | (1<<WDP3) | (1<<WDP0); break;
+        }
+    }
     wdt_reset();     
 }
 
+/******************************************
+ * uint32_t wdt_millis()
+ * 
+ * Millisecond time base continuing in power 
+ * down: wdt_clk, plus millis() since last IRQ.
+ * Resolution of sleep time is IRQ period,
+ * late up to one period after DIO0 wake.
+ *****************************************/
+uint32_t wdt_millis() {
+    uint32_t clk, ms;
+    uint8_t sreg = SREG;
+
+    cli();
+    clk = wdt_clk;
+    ms = millis() - wdt_mark;
+    if(ms >= 1000UL * wdt_period) ms = 1000UL * wdt_period - 1;   // IRQ pending
+    SREG = sreg;
+    return clk * 1000 + ms;
+}
+
 /******************************************
  * Watchdog_setup
  * 
@@ -42,12 +95,15 @@ ISR(WDT_vect) {
  *****************************************/
 void Watchdog_setup() {  
     cli();
+    wdt_reset_cause = MCUSR;
     MCUSR = 0;
     wdt_reset();
 
   /* RESET VARIABLE */
     wdt_clk=0;
     wdt_flag=0;
+    wdt_period=1;
+    wdt_wake=0;
     
     /* Start timed equence */
     WDTCSR |= (1<<WDCE) | (1<<WDE);
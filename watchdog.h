@@ -1,12 +1,25 @@
 #ifndef WD_H 
 #define WD_H
 
-/* WATCHDOG CLOCK 1HZ */
+/* WATCHDOG CLOCK IN SEC */
 extern volatile uint32_t wdt_clk;
 
 /* CLEAR THIS COUNTER TO TRIG THE WATCHDOG, AFTER 10 SEC, THE BOARD RESET ITSELF */
 extern volatile uint8_t wdt_flag;
 
+/* SET TO WDT_CLK OF NEXT DEADLINE, WATCHDOG IRQ PERIOD IS LENGHTEN UP TO 8 SEC
+   TO FIT BEFORE IT. NEW PERIOD START AFTER NEXT IRQ */
+extern volatile uint32_t wdt_wake;
+
+/* MCUSR AT BOOT (RESET CAUSE) */
+extern uint8_t wdt_reset_cause;
+
 void Watchdog_setup();
 
+/* MILLISECOND CLOCK, WDT_CLK PLUS MILLIS() SINCE LAST IRQ. MILLIS() STOP IN POWER DOWN,
+   WDT COUNTER CAN'T BE READ: AFTER DIO0 WAKE IT IS LATE BY SLEEP SINCE LAST IRQ, UP TO 
+   ONE PERIOD (8 SEC), AND JUMP FORWARD AT NEXT IRQ. NEVER GO BACK, OK FOR SHORT WAIT 
+   WHILE AWAKE (CAD SLOT), NOT AS ABSOLUTE TIME */
+uint32_t wdt_millis();
+
 #endif